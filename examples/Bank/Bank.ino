@@ -0,0 +1,41 @@
+/*
+Rotary Encoder - Encoder Bank Example
+
+Decodes 4 encoders together using an MD_REncoderBank. Each port
+used by the encoders is read only once for all the encoders.
+
+The circuit:
+* encoder n pin A to Arduino pin PIN_A[n]
+* encoder n pin B to Arduino pin PIN_B[n]
+* encoder ground pins to ground (GND)
+*/
+
+#include <MD_REncoderBank.h>
+
+const uint8_t NUM_ENCODERS = 4;
+const uint8_t PIN_A[NUM_ENCODERS] = { 2, 4, 6, 8 };
+const uint8_t PIN_B[NUM_ENCODERS] = { 3, 5, 7, 9 };
+
+// set up encoder bank object
+MD_REncoderBank<NUM_ENCODERS> RB = MD_REncoderBank<NUM_ENCODERS>(PIN_A, PIN_B);
+
+void setup() 
+{
+  Serial.begin(57600);
+  RB.begin();
+}
+
+void loop() 
+{
+  uint32_t mask = RB.read();
+
+  for (uint8_t i = 0; mask != 0; i++, mask >>= 1)
+  {
+    if (mask & 1)
+    {
+      Serial.print("\nEncoder ");
+      Serial.print(i);
+      Serial.print(RB.event(i) == DIR_CW ? " +1" : " -1");
+    }
+  }
+}
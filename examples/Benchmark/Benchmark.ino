@@ -0,0 +1,199 @@
+/*
+Rotary Encoder - Benchmark Example
+
+Measures the time taken by read() for the library configuration set by
+the compile time switches in MD_REncoder.h, and counts the steps received
+from the SignalGenerator example running on a second board to find the 
+maximum edge rate before steps are lost.
+
+The timing tests run once at startup and print the time per call in 
+microseconds and CPU cycles. The pins do not change during these tests, 
+so they time the short path taken when there is nothing to decode, which 
+is the same for all the step modes. The time in the decode path is 
+measured on the steps received from the signal generator, as the average 
+and longest read() that returned a step in each burst. The step mode 
+changes after each burst, so each mode is measured in turn.
+
+Rebuild with different compile time switches (eg, ENABLE_SPEED, 
+ENABLE_FAST_IO, ENABLE_INTERRUPT) to compare configurations.
+
+The circuit:
+* signal generator or encoder pin A to Arduino pin 2
+* signal generator or encoder pin B to Arduino pin 3
+* signal generator or encoder ground pin to ground (GND)
+*/
+
+#include <MD_REncoder.h>
+
+const uint8_t PIN_A = 2;
+const uint8_t PIN_B = 3;
+
+const uint16_t LOOPS = 1000;       // calls timed for each test
+const uint16_t BURST_CYCLES = 100; // Gray code cycles in each burst, must match the SignalGenerator
+const uint16_t BURST_GAP = 200;    // ms without steps that ends a burst
+
+// step modes for the edge rate test, in turn
+const MD_REncoder::stepMode_t STEP_MODE[] = { MD_REncoder::STEP_FULL, MD_REncoder::STEP_HALF, MD_REncoder::STEP_QUARTER };
+const char *modeName[] = { "full", "half", "quarter" };
+const uint8_t stepsPerCycle[] = { 1, 2, 4 };
+
+// set up encoder object
+MD_REncoder R = MD_REncoder(PIN_A, PIN_B, STEP_MODE[0]);
+
+// burst data
+uint8_t mode = 0;       // index of the step mode for this burst
+uint16_t count = 0;     // steps in this burst
+uint32_t timeFirst;     // time of the first step in micros()
+uint32_t timeLast;      // time of the last step in micros()
+uint32_t readSum = 0;   // total time of the read() calls that returned a step in micros()
+uint32_t readMax = 0;   // longest read() that returned a step in micros()
+
+uint32_t overhead(void)
+// time an empty loop so that it can be taken from the test times
+{
+  volatile uint8_t x = 0;
+  uint32_t t = micros();
+
+  for (uint16_t i = 0; i < LOOPS; i++)
+    x = x + 1;
+
+  return(micros() - t);
+}
+
+void report(const char *label, uint32_t t)
+// print the time per call from the total time for LOOPS calls
+{
+  uint32_t ohead = overhead();
+
+  t = (t > ohead ? t - ohead : 0);
+
+  Serial.print(F("\n"));
+  Serial.print(label);
+  Serial.print(F(": "));
+  Serial.print((float)t / LOOPS, 2);
+  Serial.print(F(" us, "));
+  Serial.print((uint32_t)(((uint64_t)t * (F_CPU / 1000000UL)) / LOOPS));
+  Serial.print(F(" cycles"));
+}
+
+void benchmark(void)
+{
+  volatile uint8_t x;
+  uint32_t t;
+
+  Serial.print(F("\n\nConfiguration"));
+  Serial.print(F("\nF_CPU ")); Serial.print(F_CPU);
+  Serial.print(F("\nENABLE_SPEED ")); Serial.print(ENABLE_SPEED);
+  Serial.print(F("\nENABLE_SPEED_INTERVAL ")); Serial.print(ENABLE_SPEED_INTERVAL);
+  Serial.print(F("\nENABLE_POSITION ")); Serial.print(ENABLE_POSITION);
+  Serial.print(F("\nENABLE_ACCEL ")); Serial.print(ENABLE_ACCEL);
+  Serial.print(F("\nENABLE_FILTER ")); Serial.print(ENABLE_FILTER);
+  Serial.print(F("\nENABLE_STATS ")); Serial.print(ENABLE_STATS);
+  Serial.print(F("\nENABLE_OVERRUN ")); Serial.print(ENABLE_OVERRUN);
+  Serial.print(F("\nENABLE_INTERRUPT ")); Serial.print(ENABLE_INTERRUPT);
+  Serial.print(F("\nRE_FAST_IO ")); Serial.print(RE_FAST_IO);
+  Serial.print(F("\nRE_HW_COUNTER ")); Serial.print(RE_HW_COUNTER);
+
+  Serial.print(F("\n\nTime per call"));
+
+  // reference for the port reads
+  t = micros();
+  for (uint16_t i = 0; i < LOOPS; i++)
+    x = (digitalRead(PIN_B) << 1) | digitalRead(PIN_A);
+  report("2 x digitalRead()", micros() - t);
+  (void)x;
+
+  t = micros();
+  for (uint16_t i = 0; i < LOOPS; i++)
+    x = R.read();
+  report("read() idle", micros() - t);
+
+#if ENABLE_SPEED
+  {
+    // read(now) takes the time in ms, read once for all the calls
+    uint32_t now = millis();
+
+    t = micros();
+    for (uint16_t i = 0; i < LOOPS; i++)
+      x = R.read(now);
+    report("read(now) idle", micros() - t);
+  }
+#endif
+
+#if ENABLE_INTERRUPT
+  // the pins do not change so this is the ISR entry cost
+  t = micros();
+  for (uint16_t i = 0; i < LOOPS; i++)
+    R.isr();
+  report("isr() idle", micros() - t);
+#endif
+
+  Serial.print(F("\n\nWaiting for the signal generator, "));
+  Serial.print(BURST_CYCLES);
+  Serial.print(F(" cycles per burst"));
+}
+
+void setup()
+{
+  Serial.begin(57600);
+#if ENABLE_INTERRUPT
+  R.begin(false);     // poll for the timing tests
+#else
+  R.begin();
+#endif
+  benchmark();
+#if ENABLE_INTERRUPT
+  R.begin(true);      // use the interrupts if they are available
+  Serial.print(R.isInterrupt() ? F("\nUsing interrupts") : F("\nPolling"));
+#endif
+}
+
+void loop()
+{
+  uint32_t t = micros();
+  uint8_t x = R.read();
+
+  if (x != DIR_NONE)
+  {
+    uint32_t now = micros();
+
+    readSum += now - t;
+    if (now - t > readMax) readMax = now - t;
+    if (count == 0) timeFirst = now;
+    timeLast = now;
+    count++;
+  }
+  else if (count != 0 && (t - timeLast) / 1000 >= BURST_GAP)
+  {
+    // end of burst, so report it
+    uint16_t expected = BURST_CYCLES * stepsPerCycle[mode];
+    uint32_t dt = timeLast - timeFirst;
+
+    Serial.print(F("\n"));
+    Serial.print(modeName[mode]);
+    Serial.print(F(" steps "));
+    Serial.print(count);
+    Serial.print(F("/"));
+    Serial.print(expected);
+    if (dt != 0)
+    {
+      Serial.print(F(" at "));
+      Serial.print((uint32_t)(((uint64_t)(count - 1) * (4 / (expected / BURST_CYCLES)) * 1000000UL) / dt));
+      Serial.print(F(" edges/s"));
+    }
+    Serial.print(F(", read() avg "));
+    Serial.print((float)readSum / count, 2);
+    Serial.print(F(" max "));
+    Serial.print(readMax);
+    Serial.print(F(" us"));
+    Serial.print(count == expected ? F(" OK") : F(" LOST"));
+
+    count = 0;
+    readSum = 0;
+    readMax = 0;
+
+    // measure the next step mode with the next burst
+    mode = (mode + 1) % (sizeof(STEP_MODE) / sizeof(STEP_MODE[0]));
+    R.setStepMode(STEP_MODE[mode]);
+  }
+}
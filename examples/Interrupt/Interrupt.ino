@@ -0,0 +1,47 @@
+/*
+Rotary Encoder - Interrupt Example
+
+The encoder pins are decoded by the library's interrupt handlers
+and read() returns the queued events, so steps are not lost when 
+loop() is busy doing other things.
+
+ENABLE_INTERRUPT must be set to 1 in MD_REncoder.h.
+
+The circuit:
+* encoder pin A to Arduino pin 2 (external interrupt pin)
+* encoder pin B to Arduino pin 3 (external interrupt pin)
+* encoder ground pin to ground (GND)
+*/
+
+#include <MD_REncoder.h>
+
+#if !ENABLE_INTERRUPT
+#error "This example needs ENABLE_INTERRUPT set to 1 in MD_REncoder.h"
+#endif
+
+// set up encoder object
+MD_REncoder R = MD_REncoder(2, 3);
+
+void setup() 
+{
+  Serial.begin(57600);
+  if (!R.begin(true))
+    Serial.print("\nInterrupts not available, polling");
+}
+
+void loop() 
+{
+  uint8_t x;
+
+  // empty the event queue
+  while ((x = R.read()) != DIR_NONE)
+  {
+    Serial.print(x == DIR_CW ? "\n+1" : "\n-1");
+#if ENABLE_SPEED
+    Serial.print("  ");
+    Serial.print(R.speed());
+#endif
+  }
+
+  delay(100);   // simulate a busy loop
+}
@@ -0,0 +1,54 @@
+/*
+Rotary Encoder - Persistent Position Example
+
+The encoder state is saved to EEPROM once the encoder has stopped
+turning, and restored at startup, so the position carries on from 
+where it was before a reset or power cycle.
+
+ENABLE_PERSIST must be set to 1 in MD_REncoder.h.
+
+The circuit:
+* encoder pin A to Arduino pin 2
+* encoder pin B to Arduino pin 3
+* encoder ground pin to ground (GND)
+*/
+
+#include <MD_REncoder.h>
+
+#if !ENABLE_PERSIST
+#error "This example needs ENABLE_PERSIST set to 1 in MD_REncoder.h"
+#else
+#include <MD_REncoderSaver.h>
+
+const uint16_t EEPROM_BASE = 0;   // address of the first slot
+const uint8_t EEPROM_SLOTS = 8;   // number of slots to spread the wear over
+
+// set up encoder and saver objects
+MD_REncoder R = MD_REncoder(2, 3);
+MD_REncoderSaver S = MD_REncoderSaver(R, EEPROM_BASE, EEPROM_SLOTS);
+
+void setup() 
+{
+  Serial.begin(57600);
+#if defined(ESP32) || defined(ESP8266) || defined(ARDUINO_ARCH_RP2040)
+  EEPROM.begin(EEPROM_BASE + EEPROM_SLOTS * MD_REncoderSaver::SLOT_SIZE);
+#endif
+  R.begin();
+  Serial.print(S.begin() ? "\nRestored at " : "\nNo saved state, starting at ");
+  Serial.print(R.getPosition());
+}
+
+void loop() 
+{
+  uint8_t x = R.read();
+  
+  if (x)
+  {
+    Serial.print("\n");
+    Serial.print(R.getPosition());
+  }
+
+  if (S.update())
+    Serial.print(" saved");
+}
+#endif
@@ -0,0 +1,57 @@
+/*
+Rotary Encoder - Timer Sampler Example
+
+Two encoders are sampled from a timer interrupt at a fixed rate and 
+read() returns the queued events, so steps are not lost when loop() 
+is busy doing other things and any pins can be used.
+
+ENABLE_INTERRUPT and ENABLE_TIMER must be set to 1 in MD_REncoder.h.
+
+The circuit:
+* encoder 1 pins A and B to Arduino pins 4 and 5
+* encoder 2 pins A and B to Arduino pins 6 and 7
+* encoder ground pins to ground (GND)
+*/
+
+#include <MD_REncoder.h>
+
+#if !ENABLE_TIMER
+#error "This example needs ENABLE_TIMER set to 1 in MD_REncoder.h"
+#else
+
+const uint16_t SAMPLE_RATE = 2000;  // samples per second
+
+// set up encoder objects
+MD_REncoder R1 = MD_REncoder(4, 5);
+MD_REncoder R2 = MD_REncoder(6, 7);
+
+void setup() 
+{
+  Serial.begin(57600);
+  R1.begin();
+  R2.begin();
+  R1.attachSampler();
+  R2.attachSampler();
+  if (!MD_REncoder::beginSampler(SAMPLE_RATE))
+    Serial.print("\nTimer not available");
+}
+
+void report(MD_REncoder &R, const char *label)
+// empty the event queue for one encoder
+{
+  uint8_t x;
+
+  while ((x = R.read()) != DIR_NONE)
+  {
+    Serial.print(label);
+    Serial.print(x == DIR_CW ? "+1" : "-1");
+  }
+}
+
+void loop() 
+{
+  report(R1, "\nR1 ");
+  report(R2, "\nR2 ");
+  delay(200);   // simulate a busy loop
+}
+#endif
@@ -0,0 +1,75 @@
+/*
+Rotary Encoder - Signal Generator Example
+
+Drives two pins with a quadrature signal to stand in for an encoder 
+when running the Benchmark example on a second board. Bursts of 
+BURST_CYCLES Gray code cycles are sent at an edge rate that increases 
+for each burst, up to MAX_RATE. The Benchmark board reports the steps 
+received for each burst, showing the edge rate at which steps are lost.
+
+The edge rates that can be generated depend on this board. At high 
+rates the time per edge is set by the time to write the pins, and 
+the Benchmark measurement of the actual rate should be used.
+
+The circuit:
+* Arduino pin 2 to the Benchmark board pin 2 (A)
+* Arduino pin 3 to the Benchmark board pin 3 (B)
+* ground (GND) to the Benchmark board ground (GND)
+*/
+
+const uint8_t PIN_A = 2;
+const uint8_t PIN_B = 3;
+
+const uint16_t BURST_CYCLES = 100; // Gray code cycles in each burst, must match the Benchmark
+const uint16_t BURST_GAP = 500;    // ms between bursts
+const uint32_t START_RATE = 100;   // edges per second for the first burst
+const uint32_t MAX_RATE = 200000;  // edges per second for the last burst
+
+// CW Gray code sequence as (B<<1)|A, starting from the rest position
+const uint8_t GRAY[4] = { 1, 0, 2, 3 };
+
+uint32_t rate = START_RATE;
+
+void burst(uint32_t edgeRate)
+// send BURST_CYCLES CW cycles, one edge every 1/edgeRate seconds
+{
+  uint32_t period = 1000000UL / edgeRate;
+  uint32_t t = micros();
+
+  for (uint16_t i = 0; i < BURST_CYCLES; i++)
+  {
+    for (uint8_t j = 0; j < 4; j++)
+    {
+      digitalWrite(PIN_A, GRAY[j] & 1);
+      digitalWrite(PIN_B, (GRAY[j] >> 1) & 1);
+
+      t += period;
+      while ((int32_t)(micros() - t) < 0)
+        ;   // wait for the next edge
+    }
+  }
+}
+
+void setup()
+{
+  Serial.begin(57600);
+  pinMode(PIN_A, OUTPUT);
+  pinMode(PIN_B, OUTPUT);
+  digitalWrite(PIN_A, HIGH);
+  digitalWrite(PIN_B, HIGH);
+  delay(2000);   // let the Benchmark finish its timing tests
+}
+
+void loop()
+{
+  Serial.print(F("\nBurst at "));
+  Serial.print(rate);
+  Serial.print(F(" edges/s"));
+  burst(rate);
+
+  delay(BURST_GAP);
+
+  // the steps get closer together for each burst
+  rate += rate / 4;
+  if (rate > MAX_RATE) rate = START_RATE;
+}
@@ -0,0 +1,223 @@
+/*
+Rotary Encoder - Simulation Example
+
+Runs synthetic or recorded encoder signals through the library on a 
+desktop computer, using the simulated pins and clock in MD_REncoder_Host.h. 
+For each step mode the signals are sent clean, with contact bounce and 
+with noise, and the steps counted are compared with the steps expected. 
+The time taken by read() is also measured, so that changes to the library 
+can be checked without a board.
+
+The program exits with a non-zero status if any step is lost from a clean 
+or bouncing signal. The noise rows are for information only, as a jump to 
+the opposite code is not a valid transition and a step may be lost with it.
+
+This example does not run on an Arduino. Build and run it from this folder
+with a C++11 compiler, for example
+  g++ -O2 -x c++ Simulation.ino -x none "../../src/"*.cpp -I../../src -o simulation
+  ./simulation [file]
+
+The optional file is a recorded signal of the pin codes (B<<1)|A as the 
+digits 0 to 3, one per sample. Other characters are ignored.
+*/
+
+#if defined(ARDUINO)
+#error "This example is built and run on a desktop computer, see the comments"
+#else
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <MD_REncoder.h>
+
+const uint8_t PIN_A = 2;
+const uint8_t PIN_B = 3;
+
+const uint16_t CYCLES = 1000;     // Gray code cycles in each direction
+const uint32_t SAMPLE_TIME = 100; // simulated us between samples
+const uint32_t LOOPS = 1000000;   // read() calls for the timing test
+
+const uint8_t GRAY_CW[4] = { 1, 0, 2, 3 };  // CW sequence from the rest position
+const uint8_t GRAY_CCW[4] = { 2, 0, 1, 3 }; // CCW sequence from the rest position
+
+const char *modeName[] = { "full", "half", "quarter" };
+const uint8_t stepsPerCycle[] = { 1, 2, 4 };
+
+struct result_t
+{
+  int32_t net;      // CW less CCW steps
+  uint32_t events;  // total steps
+};
+
+void sample(MD_REncoder &R, uint8_t code, result_t &r)
+// set the pins, move the clock and read the encoder
+{
+  uint8_t e;
+
+  MD_REncoderHost::setCode(PIN_A, PIN_B, code);
+  MD_REncoderHost::advance(SAMPLE_TIME);
+  e = R.read();
+  if (e != DIR_NONE)
+  {
+    r.events++;
+    r.net += (e == DIR_CW ? 1 : -1);
+  }
+}
+
+void signal(MD_REncoder &R, const uint8_t *seq, uint8_t bounce, uint16_t noise, result_t &r)
+// Send CYCLES of seq. Each edge bounces between the old and new codes 
+// bounce times, and one in noise samples jumps to the opposite code.
+{
+  uint8_t last = 3;
+
+  for (uint16_t i = 0; i < CYCLES; i++)
+  {
+    for (uint8_t j = 0; j < 4; j++)
+    {
+      for (uint8_t b = 0; b < bounce; b++)
+      {
+        sample(R, seq[j], r);
+        sample(R, last, r);
+      }
+      if (noise != 0 && rand() % noise == 0)
+        sample(R, seq[j] ^ 0x3, r);
+      sample(R, seq[j], r);
+      last = seq[j];
+    }
+  }
+}
+
+bool report(const char *label, MD_REncoder::stepMode_t mode, result_t &cw, result_t &ccw, bool info)
+// print the result and return true if no steps were lost
+{
+  int32_t expected = (int32_t)CYCLES * stepsPerCycle[mode];
+  bool ok = (cw.net == expected && -ccw.net == expected);
+
+  printf("%-8s %-6s  CW %6ld/%-6ld CCW %6ld/%-6ld  events %6lu  %s%s\n", 
+    modeName[mode], label, 
+    (long)cw.net, (long)expected, (long)-ccw.net, (long)expected,
+    (unsigned long)(cw.events + ccw.events),
+    ok ? "OK" : "LOST", info ? " (info)" : "");
+
+  return(ok);
+}
+
+bool runSignals(MD_REncoder::stepMode_t mode)
+// run the synthetic signals and return false if a required test failed
+{
+  const struct { const char *label; uint8_t bounce; uint16_t noise; bool info; } test[] =
+  {
+    { "clean", 0, 0, false },
+    { "bounce", 3, 0, false },
+    { "noise", 0, 50, true },
+  };
+  bool pass = true;
+
+  for (uint8_t t = 0; t < sizeof(test) / sizeof(test[0]); t++)
+  {
+    MD_REncoder R(PIN_A, PIN_B, mode);
+    result_t cw = { 0, 0 }, ccw = { 0, 0 };
+
+    MD_REncoderHost::setCode(PIN_A, PIN_B, 3);
+    R.begin();
+    signal(R, GRAY_CW, test[t].bounce, test[t].noise, cw);
+    signal(R, GRAY_CCW, test[t].bounce, test[t].noise, ccw);
+    if (!report(test[t].label, mode, cw, ccw, test[t].info) && !test[t].info)
+      pass = false;
+  }
+
+  return(pass);
+}
+
+void runFile(const char *name, MD_REncoder::stepMode_t mode)
+// run a recorded signal and print the steps counted
+{
+  FILE *f = fopen(name, "r");
+  MD_REncoder R(PIN_A, PIN_B, mode);
+  result_t r = { 0, 0 };
+  uint32_t samples = 0;
+  int c;
+
+  if (f == NULL)
+  {
+    printf("Cannot open %s\n", name);
+    return;
+  }
+
+  MD_REncoderHost::setCode(PIN_A, PIN_B, 3);
+  R.begin();
+  while ((c = fgetc(f)) != EOF)
+  {
+    if (c >= '0' && c <= '3')
+    {
+      sample(R, c - '0', r);
+      samples++;
+    }
+  }
+  fclose(f);
+
+  printf("%-8s %s  samples %lu  net %ld  events %lu\n", modeName[mode], name,
+    (unsigned long)samples, (long)r.net, (unsigned long)r.events);
+}
+
+void runTiming(MD_REncoder::stepMode_t mode)
+// time read() with the pins changing on every call and with them still
+{
+  MD_REncoder R(PIN_A, PIN_B, mode);
+  volatile uint8_t e;
+  std::chrono::steady_clock::time_point t;
+  double dtMove, dtIdle;
+
+  MD_REncoderHost::setCode(PIN_A, PIN_B, 3);
+  R.begin();
+
+  t = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < LOOPS; i++)
+  {
+    MD_REncoderHost::setCode(PIN_A, PIN_B, GRAY_CW[i & 3]);
+    MD_REncoderHost::advance(SAMPLE_TIME);
+    e = R.read();
+  }
+  dtMove = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t).count() / LOOPS;
+
+  t = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < LOOPS; i++)
+  {
+    MD_REncoderHost::advance(SAMPLE_TIME);
+    e = R.read();
+  }
+  dtIdle = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t).count() / LOOPS;
+  (void)e;
+
+  printf("%-8s read() moving %.1f ns, idle %.1f ns\n", modeName[mode], dtMove, dtIdle);
+}
+
+int main(int argc, char *argv[])
+{
+  const MD_REncoder::stepMode_t modes[] = { MD_REncoder::STEP_FULL, MD_REncoder::STEP_HALF, MD_REncoder::STEP_QUARTER };
+  bool pass = true;
+
+  srand(1);
+
+  printf("Step accuracy, %u cycles each way\n", CYCLES);
+  for (uint8_t m = 0; m < 3; m++)
+    if (!runSignals(modes[m]))
+      pass = false;
+
+  if (argc > 1)
+  {
+    printf("\nRecorded signal\n");
+    for (uint8_t m = 0; m < 3; m++)
+      runFile(argv[1], modes[m]);
+  }
+
+  printf("\nThroughput\n");
+  for (uint8_t m = 0; m < 3; m++)
+    runTiming(modes[m]);
+
+  if (!pass)
+    printf("\nSteps were lost from a clean or bouncing signal\n");
+
+  return(pass ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+#endif
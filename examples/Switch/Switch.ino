@@ -0,0 +1,56 @@
+/*
+Rotary Encoder - Push Switch Example
+
+Uses the event callback to handle the rotation and the push switch 
+of the encoder from one call to read(). ENABLE_SWITCH must be set to 1 
+in MD_REncoder.h.
+
+The circuit:
+* encoder pin A to Arduino pin 2
+* encoder pin B to Arduino pin 3
+* encoder switch to Arduino pin 4
+* encoder ground and switch common pins to ground (GND)
+*/
+
+#include <MD_REncoder.h>
+
+#if !ENABLE_SWITCH
+#error "This example needs ENABLE_SWITCH set to 1 in MD_REncoder.h"
+#else
+
+// set up encoder object
+MD_REncoder R = MD_REncoder(2, 3);
+
+int16_t value = 0;
+
+void encoderEvent(MD_REncoder &re, MD_REncoder::event_t ev)
+{
+  (void)re;
+
+  switch (ev)
+  {
+    case MD_REncoder::EV_CW:         value++;      break;
+    case MD_REncoder::EV_CCW:        value--;      break;
+    case MD_REncoder::EV_PRESS_CW:   value += 10;  break;
+    case MD_REncoder::EV_PRESS_CCW:  value -= 10;  break;
+    case MD_REncoder::EV_PRESS:      Serial.print("\nPress");  return;
+    case MD_REncoder::EV_LONG_PRESS: Serial.print("\nLong press, reset"); value = 0; break;
+  }
+
+  Serial.print("\nValue ");
+  Serial.print(value);
+}
+
+void setup() 
+{
+  Serial.begin(57600);
+  R.begin();
+  R.setSwitch(4);
+  R.setCallback(encoderEvent);
+}
+
+void loop() 
+{
+  R.read();
+}
+#endif
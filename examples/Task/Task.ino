@@ -0,0 +1,69 @@
+/*
+Rotary Encoder - Decode Task Example
+
+The encoder is decoded by a task on the other core (ESP32), or from 
+loop1() on the second core (RP2040), and loop() prints the shared 
+snapshot without having to read the encoder itself.
+
+ENABLE_TASK must be set to 1 in MD_REncoder.h.
+
+The circuit:
+* encoder pin A to pin 18
+* encoder pin B to pin 19
+* encoder ground pin to ground (GND)
+*/
+
+#include <MD_REncoder.h>
+
+#if !ENABLE_TASK
+#error "This example needs ENABLE_TASK set to 1 in MD_REncoder.h"
+#else
+
+const uint16_t TASK_PERIOD = 1;   // milliseconds between decodes
+const uint8_t TASK_CORE = 0;      // the Arduino loop() runs on core 1 on ESP32
+const uint8_t TASK_PRIORITY = 5;
+
+// set up encoder object
+MD_REncoder R = MD_REncoder(18, 19);
+
+void setup() 
+{
+  Serial.begin(57600);
+  R.begin();
+  R.attachTask();
+#if !defined(ARDUINO_ARCH_RP2040)
+  if (!MD_REncoder::beginTask(TASK_PERIOD, TASK_CORE, TASK_PRIORITY))
+    Serial.print("\nDecode task not available");
+#endif
+}
+
+#if defined(ARDUINO_ARCH_RP2040)
+void loop1()
+{
+  MD_REncoder::service();
+}
+#endif
+
+void loop() 
+{
+  static uint32_t lastCount = 0;
+  MD_REncoder::snapshot_t s;
+
+  R.getSnapshot(s);
+  if (s.count != lastCount)
+  {
+    lastCount = s.count;
+    Serial.print(s.dir == DIR_CW ? "\n+1" : "\n-1");
+#if ENABLE_POSITION
+    Serial.print("  pos ");
+    Serial.print(s.position);
+#endif
+#if ENABLE_SPEED
+    Serial.print("  speed ");
+    Serial.print(s.speed);
+#endif
+  }
+
+  delay(50);    // simulate a busy loop
+}
+#endif
@@ -0,0 +1,34 @@
+/*
+Rotary Encoder - Compile Time Encoder Example
+
+Uses MD_REncoderT, where the pins, step mode and speed period are 
+template parameters, so they are resolved when the code is built.
+
+The circuit:
+* encoder pin A to Arduino pin 2
+* encoder pin B to Arduino pin 3
+* encoder ground pin to ground (GND)
+*/
+
+#include <MD_REncoderT.h>
+
+// set up encoder object, full step with speed calculated every 500ms
+MD_REncoderT<2, 3, MD_REncoder::STEP_FULL, 500> R;
+
+void setup() 
+{
+  Serial.begin(57600);
+  R.begin();
+}
+
+void loop() 
+{
+  uint8_t x = R.read();
+  
+  if (x != DIR_NONE) 
+  {
+    Serial.print(x == DIR_CW ? "\n+1" : "\n-1");
+    Serial.print("  ");
+    Serial.print(R.speed());
+  }
+}
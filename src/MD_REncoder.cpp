@@ -30,85 +30,1709 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
 #include <MD_REncoder.h>
 
 /*
- * The below state table has, for each state (row), the new state
+ * The below state tables have, for each state (row), the new state
  * to set based on the next encoder output. From left to right in,
  * the table, the encoder outputs are 00, 01, 10, 11, and the value
  * in that position is the new state to set.
  */
 #define R_START 0x0
 
-#if ENABLE_HALF_STEP
-// Use the half-step state table (emits a code at 00 and 11)
-#define R_CCW_BEGIN   0x1
-#define R_CW_BEGIN    0x2
-#define R_START_M     0x3
-#define R_CW_BEGIN_M  0x4
-#define R_CCW_BEGIN_M 0x5
-
-const unsigned char ttable[][4] = 
-{
-  // 00                  01              10            11
-  {R_START_M,           R_CW_BEGIN,     R_CCW_BEGIN,  R_START},           // R_START (00)
-  {R_START_M | DIR_CCW, R_START,        R_CCW_BEGIN,  R_START},           // R_CCW_BEGIN
-  {R_START_M | DIR_CW,  R_CW_BEGIN,     R_START,      R_START},           // R_CW_BEGIN
-  {R_START_M,           R_CCW_BEGIN_M,  R_CW_BEGIN_M, R_START},           // R_START_M (11)
-  {R_START_M,           R_START_M,      R_CW_BEGIN_M, R_START | DIR_CW},  // R_CW_BEGIN_M 
-  {R_START_M,           R_CCW_BEGIN_M,  R_START_M,    R_START | DIR_CCW}  // R_CCW_BEGIN_M
-};
+// Flag in _pins set when the last sample was different from the one before
+#define PINS_CHANGED  0x80
+#define PINS_UNKNOWN  0x04  // never matches a real pin sample
+
+// Step mode in the top bits of _state when ENABLE_COMPACT is set
+#define STATE_MODE_SHIFT  6
+#if ENABLE_COMPACT
+#define STATE_MODE    0xc0
 #else
-// Use the full-step state table (emits a code at 00 only)
-#define R_CW_FINAL   0x1
-#define R_CW_BEGIN   0x2
-#define R_CW_NEXT    0x3
-#define R_CCW_BEGIN  0x4
-#define R_CCW_FINAL  0x5
-#define R_CCW_NEXT   0x6
-
-const unsigned char ttable[][4] = 
-{
-  // 00         01           10           11
-  {R_START,    R_CW_BEGIN,  R_CCW_BEGIN, R_START},           // R_START
-  {R_CW_NEXT,  R_START,     R_CW_FINAL,  R_START | DIR_CW},  // R_CW_FINAL
-  {R_CW_NEXT,  R_CW_BEGIN,  R_START,     R_START},           // R_CW_BEGIN
-  {R_CW_NEXT,  R_CW_BEGIN,  R_CW_FINAL,  R_START},           // R_CW_NEXT
-  {R_CCW_NEXT, R_START,     R_CCW_BEGIN, R_START},           // R_CCW_BEGIN
-  {R_CCW_NEXT, R_CCW_FINAL, R_START,     R_START | DIR_CCW}, // R_CCW_FINAL
-  {R_CCW_NEXT, R_CCW_FINAL, R_CCW_BEGIN, R_START}            // R_CCW_NEXT
-};
+#define STATE_MODE    0x00
+#endif
+
+// Next pin code in the CW and CCW directions (3, 1, 0, 2 is the CW 
+// Gray code sequence), packed as 2 bits per current code.
+#define CW_NEXT(c)  ((0x72 >> ((c) << 1)) & 0x3)
+#define CCW_NEXT(c) ((0x8d >> ((c) << 1)) & 0x3)
+
+// Speed arithmetic limits. The wide speed is limited to 24 bits so 
+// that the smoothing filters cannot overflow.
+#if ENABLE_WIDE_SPEED
+#define SPEED_MAX   0xffffffUL
+#define COUNT_MAX   0xffffffffUL
+#define NET_MAX     0x7fffffffL
+#else
+#define SPEED_MAX   0xffffU
+#define COUNT_MAX   0xffffU
+#define NET_MAX     0x7fff
+#endif
+#if ENABLE_COMPACT
+#undef NET_MAX
+#define NET_MAX     0x7f    // the net count is only kept for its sign
 #endif
 
-MD_REncoder::MD_REncoder(uint8_t pinA, uint8_t pinB):
-_pinA (pinA), _pinB (pinB), _state(R_START)
+// Make a block of code safe from interrupts that access the same data
+#if defined(__AVR__)
+#define RE_ATOMIC_BEGIN { uint8_t _sreg = SREG; cli();
+#define RE_ATOMIC_END   SREG = _sreg; }
+#else
+#define RE_ATOMIC_BEGIN { noInterrupts();
+#define RE_ATOMIC_END   interrupts(); }
+#endif
+
+// Half-step state table (emits a code at 00 and 11)
+#define RH_CCW_BEGIN   0x1
+#define RH_CW_BEGIN    0x2
+#define RH_START_M     0x3
+#define RH_CW_BEGIN_M  0x4
+#define RH_CCW_BEGIN_M 0x5
+
+const uint8_t MD_REncoder::_ttHalf[][4] PROGMEM = 
+{
+  // 00                   01               10             11
+  {RH_START_M,           RH_CW_BEGIN,     RH_CCW_BEGIN,  R_START},           // R_START (00)
+  {RH_START_M | DIR_CCW, R_START,         RH_CCW_BEGIN,  R_START},           // RH_CCW_BEGIN
+  {RH_START_M | DIR_CW,  RH_CW_BEGIN,     R_START,       R_START},           // RH_CW_BEGIN
+  {RH_START_M,           RH_CCW_BEGIN_M,  RH_CW_BEGIN_M, R_START},           // RH_START_M (11)
+  {RH_START_M,           RH_START_M,      RH_CW_BEGIN_M, R_START | DIR_CW},  // RH_CW_BEGIN_M 
+  {RH_START_M,           RH_CCW_BEGIN_M,  RH_START_M,    R_START | DIR_CCW}  // RH_CCW_BEGIN_M
+};
+
+// Full-step state table (emits a code at 00 only)
+#define RF_CW_FINAL   0x1
+#define RF_CW_BEGIN   0x2
+#define RF_CW_NEXT    0x3
+#define RF_CCW_BEGIN  0x4
+#define RF_CCW_FINAL  0x5
+#define RF_CCW_NEXT   0x6
+
+const uint8_t MD_REncoder::_ttFull[][4] PROGMEM = 
+{
+  // 00          01            10            11
+  {R_START,     RF_CW_BEGIN,  RF_CCW_BEGIN, R_START},           // R_START
+  {RF_CW_NEXT,  R_START,      RF_CW_FINAL,  R_START | DIR_CW},  // RF_CW_FINAL
+  {RF_CW_NEXT,  RF_CW_BEGIN,  R_START,      R_START},           // RF_CW_BEGIN
+  {RF_CW_NEXT,  RF_CW_BEGIN,  RF_CW_FINAL,  R_START},           // RF_CW_NEXT
+  {RF_CCW_NEXT, R_START,      RF_CCW_BEGIN, R_START},           // RF_CCW_BEGIN
+  {RF_CCW_NEXT, RF_CCW_FINAL, R_START,      R_START | DIR_CCW}, // RF_CCW_FINAL
+  {RF_CCW_NEXT, RF_CCW_FINAL, RF_CCW_BEGIN, R_START}            // RF_CCW_NEXT
+};
+
+// Quarter-step state table (emits a code at every valid transition).
+// The state is the last pin code seen, and a change of both pins at 
+// once is not a valid Gray code transition so it only resynchronizes 
+// the state. R_START is before the first pin code is known.
+#define RQ_00   0x1
+#define RQ_01   0x2
+#define RQ_10   0x3
+#define RQ_11   0x4
+
+const uint8_t MD_REncoder::_ttQuarter[][4] PROGMEM = 
+{
+  // 00              01              10              11
+  {RQ_00,           RQ_01,          RQ_10,          RQ_11},           // R_START
+  {RQ_00,           RQ_01 | DIR_CCW, RQ_10 | DIR_CW, RQ_11},           // RQ_00
+  {RQ_00 | DIR_CW,  RQ_01,          RQ_10,          RQ_11 | DIR_CCW}, // RQ_01
+  {RQ_00 | DIR_CCW, RQ_01,          RQ_10,          RQ_11 | DIR_CW},  // RQ_10
+  {RQ_00,           RQ_01 | DIR_CW, RQ_10 | DIR_CCW, RQ_11}            // RQ_11
+};
+
+const MD_REncoder::ttable_t *MD_REncoder::getTable(stepMode_t mode)
+// Return the state table for the step mode
+{
+  switch (mode)
+  {
+    case STEP_HALF:    return(_ttHalf);
+    case STEP_QUARTER: return(_ttQuarter);
+    default:           return(_ttFull);
+  }
+}
+
+MD_REncoder::MD_REncoder(uint8_t pinA, uint8_t pinB, stepMode_t mode):
+_pinA (pinA), _pinB (pinB),
+#if RE_PORT_INDEX
+_portA(NOT_A_PORT), _portB(NOT_A_PORT),
+#elif RE_FAST_IO
+_regA(NULL), _regB(NULL),
+#endif
+#if RE_FAST_IO
+_maskA(0), _maskB(0),
+#endif
+#if ENABLE_COMPACT
+_state((mode << STATE_MODE_SHIFT) | R_START), _pins(PINS_UNKNOWN)
+#else
+_ttable(getTable(mode)), _state(R_START), _pins(PINS_UNKNOWN)
+#endif
 #if ENABLE_SPEED
-, _period(DEFAULT_PERIOD), _count(0), _spd(0), _timeLast(0)
+, _period(DEFAULT_PERIOD), _count(0), _spd(0), _net(0), _netLast(0)
+#if !ENABLE_COMPACT
+, _span(DEFAULT_PERIOD)
+#endif
+, _timeLast(0)
+#endif
+#if ENABLE_SPEED && ENABLE_SPEED_SMOOTH
+, _smooth(SMOOTH_NONE), _smoothParam(0), _ema(0), _histSum(0), _histIdx(0)
+#endif
+#if ENABLE_SPEED && ENABLE_SPEED_INTERVAL
+, _speedMode(SPEED_WINDOW), _stall(DEFAULT_STALL), _stepDir(DIR_NONE), _stepTime(0), _interval(0)
+#endif
+#if ENABLE_POSITION
+, _pos(0), _posRead(0)
+#endif
+#if ENABLE_ACCEL
+, _curve(NULL), _curvePoints(0), _bounded(false), _posMin(0), _posMax(0)
+#endif
+#if ENABLE_FILTER
+, _filterCount(0), _filterTime(0), _cand(0), _candCount(0), _candTime(0)
+#endif
+#if ENABLE_TIMING
+, _tmSum(0), _tmCount(0), _tmStepped(false), _tmPolled(false), _tmPoll(0)
+#endif
+#if ENABLE_OVERRUN
+, _recover(false), _moveDir(DIR_NONE), _moveTime(0), _pending(DIR_NONE), _overruns(0)
+#endif
+#if ENABLE_SWITCH
+, _pinS(SW_NONE)
+#if RE_FAST_IO
+, _regS(NULL), _maskS(0)
+#endif
+, _swActive(LOW), _swRaw(0), _swFlags(0), _swDebounce(DEFAULT_DEBOUNCE), _swLong(DEFAULT_LONG_PRESS)
+, _swChange(0), _swPress(0), _callback(NULL)
+#endif
+#if ENABLE_INDEX
+, _pinZ(INDEX_NONE)
+#if RE_FAST_IO
+, _regZ(NULL), _maskZ(0)
+#endif
+, _zActive(HIGH), _zFlags(0), _zRaw(0), _cpr(0), _zCount(0), _zRef(0), _zPos(0), _revs(0)
+, _zErrors(0), _zDrift(0)
+#endif
+#if RE_HW_COUNTER
+, _hwUnit(-1), _hwOver(0), _hwTotal(0), _hwUsed(0)
+#if ENABLE_POSITION
+, _hwPos(0)
+#endif
+#endif
+#if ENABLE_INTERRUPT
+, _isr(false), _qHead(0), _qTail(0)
+#endif
+#if ENABLE_TASK
+, _seq(0)
+#endif
+#if ENABLE_ADAPTIVE
+, _adActive(false), _adMin(DEFAULT_POLL_MIN), _adMax(DEFAULT_POLL_MAX), _adInterval(DEFAULT_POLL_MIN)
+#endif
+{
+#if ENABLE_STATS
+  memset(&_stats, 0, sizeof(_stats));
+#endif
+#if ENABLE_TIMING
+  memset(&_timing, 0, sizeof(_timing));
+#endif
+#if ENABLE_SPEED && ENABLE_SPEED_SMOOTH
+  memset(_hist, 0, sizeof(_hist));
+#endif
+#if ENABLE_TASK
+  memset(&_snap, 0, sizeof(_snap));
+#endif
+}
+
+inline uint8_t MD_REncoder::readPins(void)
+// Return the current state of the A and B inputs as a 2 bit value
+// (B << 1) | A, which is the column index into the state table.
+{
+#if RE_FAST_IO
+  volatile portReg_t *ra = regA();
+
+  if (ra != NULL)
+  {
+    volatile portReg_t *rb = regB();
+    portReg_t a = *ra;
+    portReg_t b = (rb == ra) ? a : *rb;  // one read if on the same port
+
+#if ENABLE_SWITCH
+    // Sample the switch with A and B, for switchEvent() in this read().
+    // Not when called from the interrupt handler, which may be long before.
+#if ENABLE_INTERRUPT
+    if (_regS != NULL && !_isr)
+#else
+    if (_regS != NULL)
+#endif
+    {
+      _swRaw = (((_regS == ra) ? a : ((_regS == rb) ? b : *_regS)) & _maskS) ? 1 : 0;
+      _swFlags |= SW_FRESH;
+    }
+#endif
+
+#if ENABLE_INDEX
+    // The index is read with A and B in all modes
+    if (_regZ != NULL)
+      _zRaw = (((_regZ == ra) ? a : ((_regZ == rb) ? b : *_regZ)) & _maskZ) ? 1 : 0;
+    else if (_pinZ != INDEX_NONE)
+      _zRaw = digitalRead(_pinZ);
+#endif
+
+    return(((b & _maskB) ? 2 : 0) | ((a & _maskA) ? 1 : 0));
+  }
+#endif
+
+#if ENABLE_INDEX
+  if (_pinZ != INDEX_NONE)
+    _zRaw = digitalRead(_pinZ);
+#endif
+
+  return((digitalRead(_pinB) << 1) | digitalRead(_pinA));
+}
+
+inline uint8_t MD_REncoder::process(uint8_t pinstate)
+// Determine new state from the pins and state table, and 
+// return the emit bits (ie the generated event).
+{
+#if ENABLE_STATS
+  uint8_t old = _state & 0xf;
+#endif
+
+  _state = pgm_read_byte(&table()[_state & 0xf][pinstate]) | (_state & STATE_MODE); 
+
+#if ENABLE_STATS
+  // back to the start without completing a step
+  if ((_state & 0x3f) == R_START && old != R_START)
+    _stats.resets++;
+#endif
+
+  if (_state & 0x30) step(_state & 0x30);
+
+  return(_state & 0x30);
+}
+
+inline uint8_t MD_REncoder::sample(uint8_t pinstate)
+// Only run the state table if the pins have changed since the 
+// last sample, as otherwise the state cannot change.
+{
+  uint8_t last = _pins & ~PINS_CHANGED;
+
+  if (pinstate == last)
+  {
+    _pins = pinstate;
+#if ENABLE_FILTER
+    // pins went back before the change was accepted
+    if (_candCount != 0)
+    {
+      _candCount = 0;
+#if ENABLE_STATS
+      _stats.glitches++;
+#endif
+    }
+#endif
+    return(DIR_NONE);
+  }
+
+#if ENABLE_ADAPTIVE
+  _adActive = true;
+#endif
+
+#if ENABLE_FILTER
+  // Only accept the new pin state once it has been seen for the
+  // required number of samples and the required time.
+  if (_filterCount > 1 || _filterTime != 0)
+  {
+    if (_candCount == 0 || pinstate != _cand)
+    {
+#if ENABLE_STATS
+      if (_candCount != 0) _stats.glitches++;
+#endif
+      _cand = pinstate;
+      _candCount = 0;
+      if (_filterTime != 0) _candTime = micros();
+    }
+    if (_candCount < 0xff) _candCount++;
+
+    if (_candCount < _filterCount ||
+      (_filterTime != 0 && micros() - _candTime < _filterTime))
+    {
+      _pins = last;
+      return(DIR_NONE);
+    }
+    _candCount = 0;
+  }
+#endif
+
+  if ((pinstate ^ last) == 0x3)
+  {
+    // Both pins changed, so a state was skipped or it is noise. If 
+    // the encoder was moving it is most likely to have been skipped.
+#if ENABLE_OVERRUN
+    if (_moveDir != DIR_NONE)
+    {
+      uint32_t now = micros();
+
+      if (now - _moveTime < OVERRUN_TIMEOUT * 1000UL)
+      {
+        _moveTime = now;
+        return(overrun(last, pinstate));
+      }
+    }
+    _moveDir = DIR_NONE;  // stopped, so this is noise
+#endif
+#if ENABLE_STATS
+    _stats.invalid++;
+#endif
+  }
+#if ENABLE_OVERRUN
+  else if (last <= 0x3)
+  {
+    _moveDir = (CW_NEXT(last) == pinstate ? DIR_CW : DIR_CCW);
+    _moveTime = micros();
+  }
+#endif
+
+  _pins = pinstate | PINS_CHANGED;
+
+#if ENABLE_INDEX
+  if (_pinZ != INDEX_NONE)
+  {
+    uint8_t e = process(pinstate);
+
+    indexCheck(last, pinstate);
+    return(e);
+  }
+#endif
+
+  return(process(pinstate));
+}
+
+#if ENABLE_OVERRUN
+uint8_t MD_REncoder::overrun(uint8_t last, uint8_t pinstate)
+// Handle the skip from last to pinstate. When recovering, put the 
+// missing pin code back in the direction the encoder was moving.
+// If that gives two events, the second one is kept for later.
+{
+  uint8_t e, e2, mid;
+
+  _overruns++;
+  _pins = pinstate | PINS_CHANGED;
+
+  if (!_recover)
+  {
+    e = process(pinstate);
+#if ENABLE_INDEX
+    // a double transition only updates the index level
+    if (_pinZ != INDEX_NONE)
+      indexCheck(last, pinstate);
+#endif
+    return(e);
+  }
+
+  mid = (_moveDir == DIR_CW ? CW_NEXT(last) : CCW_NEXT(last));
+  e = process(mid);
+  e2 = process(pinstate);
+#if ENABLE_INDEX
+  // Count the restored edge, then check the index level, which was 
+  // read with pinstate, on the second edge.
+  if (_pinZ != INDEX_NONE)
+  {
+    _zCount += (_moveDir == DIR_CW) ? 1 : -1;
+    indexCheck(mid, pinstate);
+  }
+#endif
+  if (e == DIR_NONE)
+    return(e2);
+
+  _pending = e2;
+  return(e);
+}
+#endif
+
+void MD_REncoder::step(uint8_t e)
+// Account for a step in direction e. This is called in the 
+// context of the decoding, which may be an interrupt handler.
+{
+  (void)e;  // not used in all configurations
+
+#if ENABLE_TIMING
+  timeStep();
+#endif
+
+#if ENABLE_SPEED && ENABLE_SPEED_INTERVAL
+  // Keep a running average of the time between steps, 
+  // restarting it after a stall or a change of direction.
+  uint32_t now = micros();
+  uint32_t dt = now - _stepTime;
+
+  if (e != _stepDir || dt >= _stall * 1000UL)
+    _interval = 0;
+  else if (_interval == 0)
+    _interval = dt;
+  else
+    _interval = (3 * _interval + dt) >> 2;
+
+  _stepTime = now;
+  _stepDir = e;
+#endif
+
+#if ENABLE_POSITION
+#if RE_HW_COUNTER
+  // hwUpdate() has already added the hardware steps to the position
+  if (_hwUnit >= 0)
+    return;
+#endif
+
+#if ENABLE_ACCEL
+  // Move by the accelerated amount and keep within the bounds
+  int32_t pos = _pos;
+  uint16_t mult = accelMult();
+
+  if (e == DIR_CW) pos += mult;
+  else pos -= mult;
+
+  if (_bounded)
+  {
+    if (pos < _posMin) pos = _posMin;
+    else if (pos > _posMax) pos = _posMax;
+  }
+  _pos = pos;
+#else
+  if (e == DIR_CW) _pos++;
+  else _pos--;
+#endif
+#endif
+}
+
+#if ENABLE_INDEX
+void MD_REncoder::indexCheck(uint8_t last, uint8_t pinstate)
+// Count the edge from last to pinstate and check the index level read 
+// with it. CW the index is crossed when it becomes active and CCW when 
+// it becomes inactive, which is the same edge of the index pulse. The 
+// edge count is a function of the shaft angle alone, unlike the step 
+// count in full and half step modes, so a crossing has the same count
+// both ways when the CCW count is taken before the edge.
+{
+  uint8_t level = (_zRaw == _zActive) ? IDX_LEVEL : 0;
+  bool cw;
+
+  // direction is unknown for a double transition, which is left out 
+  // of the count so that it shows as drift
+  if (last > 0x3 || (pinstate ^ last) == 0x3)
+  {
+    _zFlags = (_zFlags & ~IDX_LEVEL) | level;
+    return;
+  }
+
+  cw = (CW_NEXT(last) == pinstate);
+  _zCount += cw ? 1 : -1;
+
+  if (level == (_zFlags & IDX_LEVEL))
+    return;
+  _zFlags ^= IDX_LEVEL;
+
+  if (cw != (level != 0))
+    return;
+
+  // A crossing in the same direction as the last one completes a 
+  // revolution, otherwise it is the same index crossed back again.
+  if (_zFlags & IDX_SEEN)
+  {
+    int32_t delta = _zCount + (cw ? 0 : 1) - _zRef;
+    int32_t expect = 0;
+
+    if (cw == ((_zFlags & IDX_CW) != 0))
+    {
+      expect = cw ? _cpr : -(int32_t)_cpr;
+      _revs += cw ? 1 : -1;
+    }
+    if (_cpr != 0 && delta != expect)
+    {
+      if (_zErrors < 0xffff) _zErrors++;
+      _zDrift = constrain(delta - expect, -0x7fff, 0x7fff);
+    }
+  }
+  _zRef = _zCount + (cw ? 0 : 1);
+  _zFlags = (_zFlags & ~IDX_CW) | IDX_SEEN | (cw ? IDX_CW : 0);
+
+  if (_zFlags & IDX_HOME)
+  {
+    _posRead -= _pos;
+    _pos = 0;
+    _revs = 0;
+    _zFlags = (_zFlags & ~IDX_HOME) | IDX_HOMED;
+  }
+  _zPos = _pos;
+}
+
+void MD_REncoder::setIndex(uint8_t pin, uint8_t active, uint16_t cpr)
+{
+  if (pin != INDEX_NONE)
+    pinMode(pin, (ENABLE_PULLUPS ? INPUT_PULLUP : INPUT));
+
+  RE_ATOMIC_BEGIN;
+  _pinZ = pin;
+  _zActive = active;
+  _cpr = cpr;
+  _zFlags &= IDX_HOMED;
+#if RE_FAST_IO
+  _regZ = NULL;
+  if (pin != INDEX_NONE)
+  {
+    _regZ = (volatile portReg_t *)portInputRegister(digitalPinToPort(pin));
+    _maskZ = digitalPinToBitMask(pin);
+  }
 #endif
+  if (pin != INDEX_NONE && digitalRead(pin) == active)
+    _zFlags |= IDX_LEVEL;
+  RE_ATOMIC_END;
+}
+
+void MD_REncoder::home(void)
+{
+  RE_ATOMIC_BEGIN;
+  _zFlags = (_zFlags & ~IDX_HOMED) | IDX_HOME;
+  RE_ATOMIC_END;
+}
+
+int32_t MD_REncoder::getRevolutions(void)
+{
+  int32_t revs;
+
+  RE_ATOMIC_BEGIN;
+  revs = _revs;
+  RE_ATOMIC_END;
+
+  return(revs);
+}
+
+int32_t MD_REncoder::getIndexPosition(void)
 {
+  int32_t pos;
+
+  RE_ATOMIC_BEGIN;
+  pos = _zPos;
+  RE_ATOMIC_END;
+
+  return(pos);
 }
+#endif
 
 void MD_REncoder::begin(void)
+{
+  begin(false);
+}
+
+bool MD_REncoder::begin(bool useInterrupt)
 {
   pinMode(_pinA, (ENABLE_PULLUPS ? INPUT_PULLUP : INPUT));
   pinMode(_pinB, (ENABLE_PULLUPS ? INPUT_PULLUP : INPUT));
+
+#if RE_FAST_IO
+  // Resolve the pins to port registers once, so read() does not need
+  // to do the lookups. If either pin does not map to a port then leave
+  // the registers NULL and read() falls back to digitalRead().
+#if RE_PORT_INDEX
+  _portA = digitalPinToPort(_pinA);
+  _portB = digitalPinToPort(_pinB);
+  if (_portA == NOT_A_PORT || _portB == NOT_A_PORT)
+    _portA = _portB = NOT_A_PORT;
+#else
+  _regA = (volatile portReg_t *)portInputRegister(digitalPinToPort(_pinA));
+  _regB = (volatile portReg_t *)portInputRegister(digitalPinToPort(_pinB));
+  if (_regA == NULL || _regB == NULL)
+    _regA = _regB = NULL;
+#endif
+  _maskA = digitalPinToBitMask(_pinA);
+  _maskB = digitalPinToBitMask(_pinB);
+#endif
+
+  // Prime the state from the current pins. No table emits an event 
+  // from R_START, but the quarter-step table needs the starting code
+  // to count the first transition.
+  _state = (_state & STATE_MODE) | R_START;
+  _pins = readPins();
+  process(_pins);
+
+#if RE_HW_COUNTER
+  // A hardware counter does not need interrupts
+  if (isHardware() || hwBegin())
+    return(true);
+#endif
+
+#if ENABLE_INTERRUPT
+  if (useInterrupt && !_isr)
+    _isr = attachISR();
+#if ENABLE_PCINT
+  if (useInterrupt && !_isr)
+    _isr = attachPCINT();
+#endif
+
+  return(_isr == useInterrupt);
+#else
+  return(!useInterrupt);
+#endif
 }
 
-uint8_t MD_REncoder::read(void) 
-// Grab state of input pins, determine new state from the pins 
-// and state table, and return the emit bits (ie the generated event).
+void MD_REncoder::setStepMode(stepMode_t mode)
 {
-  uint8_t pinstate = (digitalRead(_pinB) << 1) | digitalRead(_pinA);
-  
-  _state = ttable[_state & 0xf][pinstate]; 
-  
-#if ENABLE_SPEED
-  // handle the encoder velocity calc
-  if (_state & 0x30) _count++;
-  if (millis() - _timeLast >= _period)
+#if ENABLE_COMPACT
+  _state = (mode << STATE_MODE_SHIFT) | R_START;
+#else
+  _ttable = getTable(mode);
+  _state = R_START;
+#endif
+  if (_pins != PINS_UNKNOWN)
+    process(_pins & ~PINS_CHANGED);
+}
+
+MD_REncoder::stepMode_t MD_REncoder::getStepMode(void)
+{
+#if ENABLE_COMPACT
+  return((stepMode_t)(_state >> STATE_MODE_SHIFT));
+#else
+  if (_ttable == _ttHalf) return(STEP_HALF);
+  if (_ttable == _ttQuarter) return(STEP_QUARTER);
+  return(STEP_FULL);
+#endif
+}
+
+#if ENABLE_INTERRUPT
+MD_REncoder *MD_REncoder::_isrObj[MAX_ISR_ENCODERS] = { NULL };
+
+// The built-in interrupt handlers, one per _isrObj[] slot
+void MD_REncoder::isr0(void) { _isrObj[0]->isr(); }
+void MD_REncoder::isr1(void) { _isrObj[1]->isr(); }
+void MD_REncoder::isr2(void) { _isrObj[2]->isr(); }
+void MD_REncoder::isr3(void) { _isrObj[3]->isr(); }
+
+bool MD_REncoder::attachISR(void)
+// Find a free handler slot and attach it to the CHANGE interrupt 
+// for both pins. Return false if this cannot be done.
+{
+  static void (* const handler[])(void) = { isr0, isr1, isr2, isr3 };
+  int intA = digitalPinToInterrupt(_pinA);
+  int intB = digitalPinToInterrupt(_pinB);
+
+  if (intA == NOT_AN_INTERRUPT || intB == NOT_AN_INTERRUPT)
+    return(false);
+
+  for (uint8_t i = 0; i < MAX_ISR_ENCODERS && i < sizeof(handler)/sizeof(handler[0]); i++)
+  {
+    if (_isrObj[i] == NULL)
+    {
+      _isrObj[i] = this;
+      _qHead = _qTail = 0;
+      attachInterrupt(intA, handler[i], CHANGE);
+      attachInterrupt(intB, handler[i], CHANGE);
+      return(true);
+    }
+  }
+
+  return(false);
+}
+
+void MD_REncoder::isr(void)
+{
+  isrSample(readPins());
+}
+
+void MD_REncoder::isrSample(uint8_t pinstate)
+// Decode the pin state and queue the event, if any. The event is 
+// dropped if the queue is full (one slot is kept empty to tell
+// a full queue from an empty one).
+{
+  uint8_t e = sample(pinstate);
+
+  if (e != DIR_NONE) push(e);
+
+#if ENABLE_OVERRUN
+  if (_pending != DIR_NONE)
+  {
+    push(_pending);
+    _pending = DIR_NONE;
+  }
+#endif
+}
+
+inline void MD_REncoder::push(uint8_t e)
+{
+  uint8_t next = (_qHead + 1) & (EVENT_QUEUE_SIZE - 1);
+
+  if (next != _qTail)
+  {
+    _queue[_qHead] = e;
+#if ENABLE_EVENT_TIME || ENABLE_TIMING
+    _qTime[_qHead] = micros();
+#endif
+    _qHead = next;
+  }
+}
+#endif
+
+inline uint8_t MD_REncoder::nextEvent(void)
+// Grab state of input pins, or the next event from the interrupt
+// queue or hardware counter, and return the generated event.
+{
+#if RE_HW_COUNTER
+  if (_hwUnit >= 0)
+    return(hwEvent());
+#endif
+
+#if ENABLE_INTERRUPT
+  if (_isr)
+  {
+    uint8_t tail = _qTail;
+    uint8_t e = DIR_NONE;
+
+    if (tail != _qHead)
+    {
+      e = _queue[tail];
+#if ENABLE_TIMING
+      timeLatency(_qTime[tail]);
+#endif
+      _qTail = (tail + 1) & (EVENT_QUEUE_SIZE - 1);
+    }
+    return(e);
+  }
+#endif
+
+#if ENABLE_OVERRUN
+  if (_pending != DIR_NONE)
   {
-    _spd = _count * (1000/_period);
-    _timeLast = millis();
-    _count = 0;
+    uint8_t e = _pending;
+
+    _pending = DIR_NONE;
+    return(e);
   }
 #endif
 
-  return (_state & 0x30);
+  return(sample(readPins()));
 }
+
+bool MD_REncoder::isIdle(void)
+{
+#if RE_HW_COUNTER
+  if (_hwUnit >= 0)
+  {
+    int32_t d;
+
+    hwUpdate();
+    d = _hwTotal - _hwUsed;
+    return(d < hwDivisor() && -d < hwDivisor());
+  }
+#endif
+
+#if ENABLE_INTERRUPT
+  if (_isr)
+    return(_qTail == _qHead);
+#endif
+
+  return(!(_pins & PINS_CHANGED));
+}
+
+uint8_t MD_REncoder::read(void) 
+// The clock is only read when there is an event to count or a switch
+// to time, and the expired period is otherwise closed off when the 
+// speed is requested.
+{
+  uint8_t e;
+
+#if ENABLE_TIMING
+  timePoll();
+#endif
+  e = nextEvent();
+  
+#if ENABLE_SWITCH
+  if (_pinS != SW_NONE)
+  {
+    uint32_t now = millis();
+
+#if ENABLE_SPEED
+    countSpeed(e, now);
+#endif
+    switchEvent(e, now);
+    return(e);
+  }
+  switchEvent(e, 0);
+#endif
+
+#if ENABLE_SPEED
+  if (e != DIR_NONE) countSpeed(e, millis());
+#endif
+
+  return(e);
+}
+
+uint8_t MD_REncoder::read(uint32_t now) 
+{
+  uint8_t e;
+
+#if ENABLE_TIMING
+  timePoll();
+#endif
+  e = nextEvent();
+  
+#if ENABLE_SPEED
+  countSpeed(e, now);
+#endif
+#if ENABLE_SWITCH
+  switchEvent(e, now);
+#endif
+
+  (void)now;  // not used in all configurations
+  return(e);
+}
+
+uint8_t MD_REncoder::readEvents(eventRec_t *buf, uint8_t max, uint8_t id)
+{
+  uint8_t n = 0;
+
+#if ENABLE_TIMING
+  timePoll();
+#endif
+
+#if ENABLE_INTERRUPT
+  if (_isr)
+  {
+    // Copy up to the head as it is now. Only _qTail is written 
+    // here, so the interrupt handler can keep adding events.
+    uint8_t head = _qHead;
+    uint8_t tail = _qTail;
+
+    while (tail != head && n < max)
+    {
+      buf[n].id = id;
+      buf[n].dir = _queue[tail];
+#if ENABLE_EVENT_TIME
+      buf[n].time = _qTime[tail];
+#endif
+#if ENABLE_TIMING
+      timeLatency(_qTime[tail]);
+#endif
+      tail = (tail + 1) & (EVENT_QUEUE_SIZE - 1);
+      n++;
+    }
+    _qTail = tail;
+  }
+  else
+#endif
+  {
+    uint8_t e;
+
+    while (n < max && (e = nextEvent()) != DIR_NONE)
+    {
+      buf[n].id = id;
+      buf[n].dir = e;
+#if ENABLE_EVENT_TIME
+      buf[n].time = micros();
+#endif
+      n++;
+    }
+  }
+
+  // account for the events as read() would
+#if ENABLE_SPEED || ENABLE_SWITCH
+#if ENABLE_SWITCH
+  if (n != 0 || _pinS != SW_NONE)
+#else
+  if (n != 0)
+#endif
+  {
+    uint32_t now = millis();
+
+    for (uint8_t i = 0; i < n; i++)
+    {
+#if ENABLE_SPEED
+      countSpeed(buf[i].dir, now);
+#endif
+#if ENABLE_SWITCH
+      switchEvent(buf[i].dir, now);
+#endif
+    }
+#if ENABLE_SWITCH
+    if (n == 0) switchEvent(DIR_NONE, now);
+#endif
+  }
+#endif
+
+  return(n);
+}
+
+#if ENABLE_SPEED
+void MD_REncoder::countSpeed(uint8_t e, uint32_t now)
+// Count the event e at time now in the current sampling 
+// period, closing off the previous period if it has expired.
+{
+  if ((stamp_t)(now - _timeLast) >= _period)
+    endPeriod(now);
+
+  // saturate rather than wrap
+  if (e == DIR_NONE) return;
+  if (_count != COUNT_MAX) _count++;
+  if (e == DIR_CW) { if (_net != NET_MAX) _net++; }
+  else if (_net != -NET_MAX) _net--;
+}
+
+void MD_REncoder::endPeriod(uint32_t now)
+// Calculate the speed for the period that has just ended. As the end
+// may be noticed late, the actual elapsed time is used. If more than 
+// two periods have elapsed the last complete period had no clicks.
+{
+  uint32_t dt = (stamp_t)(now - _timeLast);
+
+  if (dt >= 2UL * _period)
+  {
+    _spd = 0;
+    _netLast = 0;
+#if !ENABLE_COMPACT
+    _span = _period;
+#endif
+  }
+  else
+  {
+    uint32_t spd;
+
+    // only needs 64 bits for more than 4294967 clicks in a period
+#if ENABLE_WIDE_SPEED
+    if (_count > 0xffffffffUL / 1000)
+    {
+      uint64_t s = ((uint64_t)_count * 1000) / dt;
+
+      spd = (s > SPEED_MAX ? SPEED_MAX : s);
+    }
+    else
+#endif
+    spd = ((uint32_t)_count * 1000) / dt;
+
+    _spd = (spd > SPEED_MAX ? SPEED_MAX : spd);
+    _netLast = _net;
+#if !ENABLE_COMPACT
+    _span = dt;
+#endif
+  }
+
+#if ENABLE_SPEED_SMOOTH
+  if (_smooth != SMOOTH_NONE)
+    _spd = smoothSpeed(_spd, dt / _period);
+#endif
+
+  _timeLast = now;
+  _count = 0;
+  _net = 0;
+}
+
+#if ENABLE_SPEED_SMOOTH
+void MD_REncoder::setSpeedSmoothing(smooth_t mode, uint8_t param)
+{
+  if (mode == SMOOTH_AVERAGE && param > SPEED_HISTORY) param = SPEED_HISTORY;
+  if (param == 0) mode = SMOOTH_NONE;
+
+  _smooth = mode;
+  _smoothParam = param;
+  _ema = 0;
+  memset(_hist, 0, sizeof(_hist));
+  _histSum = 0;
+  _histIdx = 0;
+}
+
+MD_REncoder::speed_t MD_REncoder::smoothSpeed(speed_t spd, uint32_t periods)
+// Add the speed for the period just ended to the filter, followed by 
+// zero speed for the rest of the periods that have elapsed with no 
+// steps, and return the filtered speed.
+{
+  // the filters have forgotten the older periods by this many
+  if (periods > 32) periods = 32;
+
+  if (_smooth == SMOOTH_EMA)
+  {
+    int32_t x = (int32_t)spd << 4;
+
+    // The correction is rounded away from zero so that the filter 
+    // always reaches the input, and in particular settles at 0.
+    for (uint8_t i = 0; i < periods; i++)
+    {
+#if ENABLE_WIDE_SPEED
+      int64_t d = (int64_t)(x - (int32_t)_ema) * _smoothParam;
+#else
+      int32_t d = (x - (int32_t)_ema) * _smoothParam;
+#endif
+
+      _ema += (d >= 0 ? d + 255 : d - 255) / 256;
+      x = 0;
+    }
+    return((_ema + 8) >> 4);
+  }
+
+  // SMOOTH_AVERAGE
+  for (uint8_t i = 0; i < periods; i++)
+  {
+    _histSum = _histSum - _hist[_histIdx] + spd;
+    _hist[_histIdx] = spd;
+    if (++_histIdx >= _smoothParam) _histIdx = 0;
+    spd = 0;
+  }
+  return(_histSum / _smoothParam);
+}
+#endif
+
+MD_REncoder::speed_t MD_REncoder::speedWindow(void)
+{
+  uint32_t now = millis();
+
+  if ((stamp_t)(now - _timeLast) >= _period)
+    endPeriod(now);
+
+  return(_spd);
+}
+#endif
+
+#if ENABLE_POSITION
+int32_t MD_REncoder::getPosition(void)
+{
+  int32_t pos;
+
+#if RE_HW_COUNTER
+  if (_hwUnit >= 0) hwUpdate();
+#endif
+
+  RE_ATOMIC_BEGIN;
+  pos = _pos;
+  RE_ATOMIC_END;
+
+  return(pos);
+}
+
+void MD_REncoder::setPosition(int32_t pos)
+{
+  RE_ATOMIC_BEGIN;
+  _pos = _posRead = pos;
+  RE_ATOMIC_END;
+}
+
+int32_t MD_REncoder::readDelta(void)
+{
+  int32_t delta;
+
+#if RE_HW_COUNTER
+  if (_hwUnit >= 0) hwUpdate();
+#endif
+
+  RE_ATOMIC_BEGIN;
+  delta = _pos - _posRead;
+  _posRead = _pos;
+  RE_ATOMIC_END;
+
+  return(delta);
+}
+#endif
+
+#if ENABLE_SPEED && ENABLE_SPEED_INTERVAL
+uint32_t MD_REncoder::stepInterval(uint8_t &dir)
+// Work out the effective time between steps and the direction. If the 
+// time since the last step is longer than the average then use the 
+// elapsed time, so that the speed falls away when the encoder slows 
+// or stops. Return 0 if the encoder is stalled.
+{
+  uint32_t interval, dt;
+
+  RE_ATOMIC_BEGIN;
+  interval = _interval;
+  dir = _stepDir;
+  dt = micros() - _stepTime;
+  RE_ATOMIC_END;
+
+  if (interval == 0 || dt >= _stall * 1000UL)
+    return(0);
+
+  return(dt > interval ? dt : interval);
+}
+
+MD_REncoder::speed_t MD_REncoder::speedInterval(void)
+{
+  uint8_t dir;
+  uint32_t interval = stepInterval(dir);
+
+  if (interval == 0)
+    return(0);
+
+  interval = 1000000UL / interval;
+
+  return(interval > SPEED_MAX ? SPEED_MAX : interval);
+}
+#endif
+
+#if ENABLE_SPEED
+int32_t MD_REncoder::velocity(void)
+// Signed speed in Q16.16 format, with 64 bit intermediates so 
+// that the fraction is not lost in the division.
+{
+  int64_t v;
+
+#if ENABLE_SPEED_INTERVAL
+  if (_speedMode == SPEED_INTERVAL)
+  {
+    uint8_t dir;
+    uint32_t interval = stepInterval(dir);
+
+    if (interval == 0)
+      return(0);
+    v = (int64_t)(1000000LL << 16) / interval;
+    if (dir == DIR_CCW) v = -v;
+  }
+  else
+#endif
+  {
+#if ENABLE_COMPACT
+    // only the sign of the net count is known
+    v = (int64_t)speedWindow() << 16;
+    if (_netLast < 0) v = -v;
+    else if (_netLast == 0) v = 0;
+#else
+    speedWindow();
+    v = ((int64_t)_netLast << 16) * 1000 / _span;
+#endif
+  }
+
+  if (v > 0x7fffffffL) v = 0x7fffffffL;
+  if (v < -0x7fffffffL) v = -0x7fffffffL;
+
+  return((int32_t)v);
+}
+
+float MD_REncoder::velocityFloat(void)
+{
+#if ENABLE_SPEED_INTERVAL
+  if (_speedMode == SPEED_INTERVAL)
+  {
+    uint8_t dir;
+    uint32_t interval = stepInterval(dir);
+
+    if (interval == 0)
+      return(0.0);
+    return((dir == DIR_CCW ? -1000000.0 : 1000000.0) / interval);
+  }
+#endif
+
+#if ENABLE_COMPACT
+  speed_t s = speedWindow();
+
+  if (_netLast == 0) return(0.0);
+  return(_netLast < 0 ? -(float)s : (float)s);
+#else
+  speedWindow();
+  return((_netLast * 1000.0) / _span);
+#endif
+}
+#endif
+
+#if ENABLE_INTERPOLATE
+int32_t MD_REncoder::positionAt(uint32_t t, uint16_t &frac)
+// Extrapolate from the last step using the average step interval,
+// up to just before the next step. There is no fraction if there 
+// is no interval or the encoder has stalled.
+{
+  int32_t pos;
+  uint32_t interval, dt;
+  uint8_t dir;
+
+  RE_ATOMIC_BEGIN;
+  pos = _pos;
+  interval = _interval;
+  dir = _stepDir;
+  dt = t - _stepTime;
+  RE_ATOMIC_END;
+
+  frac = 0;
+  if (interval == 0 || dt >= _stall * 1000UL)
+    return(pos);
+
+  // Fraction in 1/65536 of a step, in 32 bit arithmetic. Both times 
+  // are scaled down until the interval fits in 16 bits, so (dt << 16) 
+  // cannot overflow as dt is less than the interval.
+  if (dt >= interval)
+    frac = 0xffff;
+  else
+  {
+    uint32_t f;
+
+    while (interval > 0xffff)
+    {
+      interval >>= 1;
+      dt >>= 1;
+    }
+    f = (dt << 16) / interval;
+    frac = (f > 0xffff ? 0xffff : f);
+  }
+
+  if (dir == DIR_CCW && frac != 0)
+  {
+    pos--;
+    frac = 0x10000UL - frac;
+  }
+
+  return(pos);
+}
+
+float MD_REncoder::positionAtFloat(uint32_t t)
+{
+  uint16_t frac;
+  int32_t pos = positionAt(t, frac);
+
+  return(pos + frac / 65536.0);
+}
+#endif
+
+#if ENABLE_ACCEL
+void MD_REncoder::setAccelCurve(const accelPoint_t *curve, uint8_t n)
+{
+  RE_ATOMIC_BEGIN;
+  _curve = (n == 0 ? NULL : curve);
+  _curvePoints = n;
+  RE_ATOMIC_END;
+}
+
+void MD_REncoder::makeAccelCurve(accelPoint_t *curve, uint8_t n, uint16_t speedMax, uint16_t multMax)
+// Multiplier grows as multMax^(i/(n-1)) so that each point is the 
+// same ratio larger than the one before.
+{
+  if (n < 2 || multMax == 0)
+    return;
+
+  for (uint8_t i = 0; i < n; i++)
+  {
+    float f = (float)i / (n - 1);
+
+    curve[i].speed = (uint16_t)(speedMax * f + 0.5);
+    curve[i].mult = (uint16_t)(pow(multMax, f) + 0.5);
+    if (curve[i].mult == 0) curve[i].mult = 1;
+  }
+}
+
+void MD_REncoder::setBounds(int32_t min, int32_t max)
+{
+  if (min > max)
+    return;
+
+  RE_ATOMIC_BEGIN;
+  _posMin = min;
+  _posMax = max;
+  _bounded = true;
+  if (_pos < min) _pos = min;
+  else if (_pos > max) _pos = max;
+  RE_ATOMIC_END;
+}
+
+uint16_t MD_REncoder::accelMult(void)
+// Look up the multiplier for the current speed, interpolating
+// between the curve points that the speed falls between.
+{
+  uint32_t s;
+  uint16_t spd;
+
+  if (_curve == NULL)
+    return(1);
+
+#if ENABLE_SPEED_INTERVAL
+  s = (_interval == 0 ? 0 : (1000000UL / _interval));
+#else
+  // _spd is only brought up to date by read() after this step, so 
+  // if the period has expired work out the speed endPeriod() would 
+  // give. This can run in the interrupt handler, so nothing is changed.
+  {
+    uint32_t dt = (stamp_t)((stamp_t)millis() - _timeLast);
+
+    if (dt < _period)
+      s = _spd;
+    else if (dt >= 2UL * _period)
+      s = 0;
+    else
+      s = ((uint32_t)_count * 1000) / dt;
+  }
+#endif
+  spd = (s > 0xffff ? 0xffff : s);  // the curve speeds are 16 bit
+
+  if (spd <= _curve[0].speed)
+    return(_curve[0].mult);
+
+  for (uint8_t i = 1; i < _curvePoints; i++)
+  {
+    if (spd < _curve[i].speed)
+    {
+      const accelPoint_t *p0 = &_curve[i - 1];
+      const accelPoint_t *p1 = &_curve[i];
+
+      return(p0->mult + ((int32_t)(p1->mult - p0->mult) * (spd - p0->speed)) / (p1->speed - p0->speed));
+    }
+  }
+
+  return(_curve[_curvePoints - 1].mult);
+}
+#endif
+
+#if ENABLE_FILTER
+void MD_REncoder::setFilter(uint8_t samples, uint16_t dwell)
+{
+  RE_ATOMIC_BEGIN;
+  _filterCount = samples;
+  _filterTime = dwell;
+  _candCount = 0;
+  RE_ATOMIC_END;
+}
+#endif
+
+#if ENABLE_STATS
+void MD_REncoder::getStats(stats_t &stats)
+{
+  RE_ATOMIC_BEGIN;
+  stats = _stats;
+  RE_ATOMIC_END;
+}
+
+void MD_REncoder::clearStats(void)
+{
+  RE_ATOMIC_BEGIN;
+  memset(&_stats, 0, sizeof(_stats));
+  RE_ATOMIC_END;
+}
+#endif
+
+#if ENABLE_TIMING
+void MD_REncoder::timeStep(void)
+// Record the time of the step and the interval since the last 
+// one. This is called in the decoding context.
+{
+  uint32_t now = micros();
+
+  if (_tmStepped)
+  {
+    uint32_t dt = now - _timing.lastStep;
+    uint32_t d = dt >> 7;
+    uint8_t bin = 0;
+
+    // bin 0 is below 256us, then each bin doubles
+    while (d > 1 && bin < TIMING_BINS - 1)
+    {
+      d >>= 1;
+      bin++;
+    }
+    if (_timing.hist[bin] != 0xffff) _timing.hist[bin]++;
+
+    if (dt < TIMING_IDLE)
+    {
+      if (_tmCount == 0 || dt < _timing.intervalMin) _timing.intervalMin = dt;
+      if (dt > _timing.intervalMax) _timing.intervalMax = dt;
+
+      // halve the sum and count before they overflow, keeping the mean
+      if (_tmCount == 0xffff || _tmSum > 0xffffffffUL - TIMING_IDLE)
+      {
+        _tmSum >>= 1;
+        _tmCount >>= 1;
+      }
+      _tmSum += dt;
+      _tmCount++;
+    }
+  }
+
+  _timing.lastStep = now;
+  _tmStepped = true;
+}
+
+void MD_REncoder::timePoll(void)
+{
+  uint32_t now = micros();
+
+  if (_tmPolled && now - _tmPoll > _timing.pollGapMax)
+    _timing.pollGapMax = now - _tmPoll;
+
+  _tmPoll = now;
+  _tmPolled = true;
+}
+
+void MD_REncoder::timeLatency(uint32_t t)
+{
+  uint32_t dt = micros() - t;
+
+  _timing.latencyLast = dt;
+  if (dt > _timing.latencyMax) _timing.latencyMax = dt;
+}
+
+void MD_REncoder::getTiming(timing_t &timing)
+{
+  uint32_t sum;
+  uint16_t count;
+
+  RE_ATOMIC_BEGIN;
+  timing = _timing;
+  sum = _tmSum;
+  count = _tmCount;
+  RE_ATOMIC_END;
+
+  timing.intervalMean = (count == 0 ? 0 : sum / count);
+}
+
+void MD_REncoder::clearTiming(void)
+{
+  RE_ATOMIC_BEGIN;
+  memset(&_timing, 0, sizeof(_timing));
+  _tmSum = 0;
+  _tmCount = 0;
+  _tmStepped = false;
+  _tmPolled = false;
+  RE_ATOMIC_END;
+}
+#endif
+
+#if ENABLE_OVERRUN
+uint32_t MD_REncoder::getOverruns(void)
+{
+  uint32_t n;
+
+  RE_ATOMIC_BEGIN;
+  n = _overruns;
+  RE_ATOMIC_END;
+
+  return(n);
+}
+
+void MD_REncoder::clearOverruns(void)
+{
+  RE_ATOMIC_BEGIN;
+  _overruns = 0;
+  RE_ATOMIC_END;
+}
+#endif
+
+#if ENABLE_SWITCH
+void MD_REncoder::setSwitch(uint8_t pin, uint8_t active)
+{
+  _pinS = pin;
+  _swActive = active;
+  _swFlags = 0;
+#if RE_FAST_IO
+  _regS = NULL;
+#endif
+  if (pin == SW_NONE)
+    return;
+
+  pinMode(_pinS, (ENABLE_PULLUPS ? INPUT_PULLUP : INPUT));
+#if RE_FAST_IO
+  _regS = (volatile portReg_t *)portInputRegister(digitalPinToPort(_pinS));
+  _maskS = digitalPinToBitMask(_pinS);
+#endif
+}
+
+uint8_t MD_REncoder::readSwitch(void)
+{
+#if RE_FAST_IO
+  if (_regS != NULL)
+    return((*_regS & _maskS) ? 1 : 0);
+#endif
+
+  return(digitalRead(_pinS) ? 1 : 0);
+}
+
+void MD_REncoder::switchEvent(uint8_t e, uint32_t now)
+// Debounce the switch, work out the switch events and call the 
+// callback for them and for the step event e.
+{
+  if (_pinS != SW_NONE)
+  {
+    bool pressed;
+
+    if (!(_swFlags & SW_FRESH))
+      _swRaw = readSwitch();
+    _swFlags &= ~SW_FRESH;
+    pressed = (_swRaw == (_swActive == HIGH ? 1 : 0));
+
+    if (pressed != ((_swFlags & SW_PRESSED) != 0))
+    {
+      // raw level differs, accept it once it has been stable long enough
+      if (!(_swFlags & SW_CHANGING))
+      {
+        _swFlags |= SW_CHANGING;
+        _swChange = now;
+      }
+      else if ((uint16_t)(now - _swChange) >= _swDebounce)
+      {
+        _swFlags = (_swFlags & ~SW_CHANGING) ^ SW_PRESSED;
+        if (pressed)
+        {
+          _swFlags &= ~(SW_TURNED | SW_LONG);
+          _swPress = now;
+        }
+        else if (!(_swFlags & (SW_TURNED | SW_LONG)) && _callback != NULL)
+          _callback(*this, EV_PRESS);
+      }
+    }
+    else
+    {
+      _swFlags &= ~SW_CHANGING;   // bounced back
+
+      if ((_swFlags & (SW_PRESSED | SW_TURNED | SW_LONG)) == SW_PRESSED && 
+          (uint16_t)(now - _swPress) >= _swLong)
+      {
+        _swFlags |= SW_LONG;
+        if (_callback != NULL) _callback(*this, EV_LONG_PRESS);
+      }
+    }
+  }
+
+  if (e != DIR_NONE)
+  {
+    if (_swFlags & SW_PRESSED)
+    {
+      _swFlags |= SW_TURNED;
+      if (_callback != NULL) _callback(*this, (e == DIR_CW) ? EV_PRESS_CW : EV_PRESS_CCW);
+    }
+    else if (_callback != NULL) 
+      _callback(*this, (e == DIR_CW) ? EV_CW : EV_CCW);
+  }
+}
+#endif
+
+#if ENABLE_ADAPTIVE
+uint32_t MD_REncoder::pollInterval(void)
+// Drop to the shortest interval when the pins have changed, otherwise 
+// back off exponentially. While the encoder is turning the interval is 
+// kept to the one for the speed, as most polls see no change.
+{
+  uint32_t limit = _adMax;
+
+#if ENABLE_SPEED
+  // edges per second for the steps per second measured
+  uint32_t edges = (uint32_t)speed() * (4 >> getStepMode());
+
+  if (edges != 0)
+  {
+    // constrain() may be a macro, so only divide once
+    uint32_t t = 1000000UL / (edges * POLL_MARGIN);
+
+    limit = constrain(t, (uint32_t)_adMin, _adMax);
+  }
+#endif
+
+  if (_adActive)
+  {
+    _adActive = false;
+    _adInterval = (limit < _adMax) ? limit : _adMin;
+  }
+  else if (_adInterval < limit)
+    _adInterval = (_adInterval > limit / 2) ? limit : (_adInterval << 1);
+  else
+    _adInterval = limit;
+
+  return(_adInterval);
+}
+#endif
+
+#if ENABLE_PERSIST
+// First byte of the saved state, which changes with the layout
+#define PERSIST_TAG   (0xa0 | (ENABLE_FILTER ? 0x01 : 0) | (ENABLE_INDEX ? 0x02 : 0))
+
+static uint8_t persistCRC(const uint8_t *buf, uint8_t len)
+// CRC-8 (polynomial 0x07) of len bytes of buf
+{
+  uint8_t crc = 0;
+
+  while (len--)
+  {
+    crc ^= *buf++;
+    for (uint8_t i = 0; i < 8; i++)
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+  }
+
+  return(crc);
+}
+
+static void persistPut(uint8_t *&p, uint32_t v, uint8_t bytes)
+// Write the low bytes of v to p, least significant first
+{
+  while (bytes--)
+  {
+    *p++ = v & 0xff;
+    v >>= 8;
+  }
+}
+
+static uint32_t persistGet(const uint8_t *&p, uint8_t bytes)
+// Read a value written by persistPut()
+{
+  uint32_t v = 0;
+
+  for (uint8_t i = 0; i < bytes; i++)
+    v |= (uint32_t)*p++ << (i << 3);
+
+  return(v);
+}
+
+uint8_t MD_REncoder::serialize(uint8_t *buf, uint8_t size)
+// The layout is the tag, then the step mode, pins and state packed 
+// in one byte, the position, the optional data and the CRC.
+{
+  uint8_t *p = buf;
+
+  if (size < PERSIST_SIZE)
+    return(0);
+
+  *p++ = PERSIST_TAG;
+  RE_ATOMIC_BEGIN;
+  *p++ = (getStepMode() << 6) | ((_pins & 0x3) << 4) | (_state & 0xf);
+  persistPut(p, _pos, 4);
+#if ENABLE_FILTER
+  persistPut(p, _filterCount, 1);
+  persistPut(p, _filterTime, 2);
+#endif
+#if ENABLE_INDEX
+  persistPut(p, _revs, 4);
+  *p++ = _zFlags & IDX_HOMED;
+#endif
+  RE_ATOMIC_END;
+  *p = persistCRC(buf, PERSIST_SIZE - 1);
+
+  return(PERSIST_SIZE);
+}
+
+bool MD_REncoder::isValid(const uint8_t *buf, uint8_t len)
+// The state must be a row of the state table for the saved step mode
+{
+  uint8_t rows;
+
+  if (len < PERSIST_SIZE || buf[0] != PERSIST_TAG || 
+      persistCRC(buf, PERSIST_SIZE - 1) != buf[PERSIST_SIZE - 1])
+    return(false);
+
+  switch (buf[1] >> 6)
+  {
+    case STEP_FULL:    rows = sizeof(_ttFull) / sizeof(_ttFull[0]);       break;
+    case STEP_HALF:    rows = sizeof(_ttHalf) / sizeof(_ttHalf[0]);       break;
+    case STEP_QUARTER: rows = sizeof(_ttQuarter) / sizeof(_ttQuarter[0]); break;
+    default:           return(false);
+  }
+
+  return((buf[1] & 0xf) < rows);
+}
+
+bool MD_REncoder::restore(const uint8_t *buf, uint8_t len)
+{
+  const uint8_t *p = buf + 2;
+
+  if (!isValid(buf, len))
+    return(false);
+
+  setStepMode((stepMode_t)(buf[1] >> 6));
+  setPosition((int32_t)persistGet(p, 4));
+#if ENABLE_FILTER
+  {
+    uint8_t samples = persistGet(p, 1);
+
+    setFilter(samples, persistGet(p, 2));
+  }
+#endif
+
+  RE_ATOMIC_BEGIN;
+  // Only pick up a part completed step if the shaft has not moved
+  if ((_pins & ~PINS_CHANGED) == ((buf[1] >> 4) & 0x3))
+    _state = (_state & STATE_MODE) | (buf[1] & 0xf);
+#if ENABLE_INDEX
+  _revs = (int32_t)persistGet(p, 4);
+  _zFlags = (_zFlags & ~IDX_HOMED) | (*p & IDX_HOMED);
+#endif
+  RE_ATOMIC_END;
+
+  return(true);
+}
+#endif
@@ -15,8 +15,24 @@ Features
 - Debounce handling with support for high rotation speeds
 - Correctly handles direction changes mid-step
 - Checks for valid state changes for more robust counting and noise immunity
-- Counts full-steps (default) or half-steps
+- Counts full-steps (default), half-steps or quarter-steps, selectable for each encoder
 - Calculates speed of rotation
+- Direct port register reads where the architecture supports them
+- Optional interrupt driven decoding with a lock-free event queue
+- Optional timer tick sampler to poll encoders at a fixed rate
+- Optional pin change interrupts, with one dispatcher for all the encoders on a port
+- Optional decode task on another core or RTOS task, with a lock-free snapshot
+- Multi-encoder bank that decodes many encoders from one read of each port
+- Compile time encoder template with constant pins and state table
+- Accumulates a signed position so that no steps are lost between reads
+- Optional speed based acceleration for fast value entry
+- Optional hardware quadrature counting on MCUs that support it (ESP32)
+- Optional input glitch filter, decoder statistics and missed edge detection
+- Optional debounced push switch with press, long press and press and turn callbacks
+- Optional index (Z) channel with homing, revolution count and lost step detection
+- Optional state snapshot and wear levelled EEPROM saver for a warm restart
+- Optional adaptive poll interval that backs off when idle
+- Host build with simulated pins and clock to check the decoder on a desktop computer
 
 If you like and use this library please consider making a small donation using [PayPal](https://paypal.me/MajicDesigns/4USD)
 
@@ -27,6 +43,40 @@ Topics
 
 Revision History
 ----------------
+Oct 2026 - version 1.1.0
+- Added direct port register reads (ENABLE_FAST_IO) to replace digitalRead()
+- Added built-in interrupt driven mode with lock-free event queue (ENABLE_INTERRUPT)
+- Added MD_REncoderBank to decode many encoders from one read of each port
+- Added signed position counter with atomic getPosition(), setPosition() and readDelta()
+- Step mode is now selected for each encoder with the constructor or setStepMode()
+- State tables are stored in PROGMEM
+- Added quarter-step (4x) mode for high resolution encoders
+- Added speed measurement from the time between steps (ENABLE_SPEED_INTERVAL)
+- Added signed velocity() in Q16.16 fixed point and velocityFloat()
+- Speed calculation no longer truncates 1000/period
+- read() only reads the clock when there is a step, added read(now) overload
+- read() skips the state table when the pins have not changed, added isIdle()
+- Added speed based acceleration of the position and position bounds (ENABLE_ACCEL)
+- Added hardware quadrature counter backend, ESP32 PCNT (ENABLE_HW_COUNTER)
+- Added configurable input glitch filter (ENABLE_FILTER)
+- Added counters for invalid transitions, glitches and resets (ENABLE_STATS)
+- Added missed edge detection, counting and optional recovery (ENABLE_OVERRUN)
+- Added host build support with simulated pins and clock (MD_REncoder_Host.h)
+- Added MD_REncoderT with the pins and step mode fixed at compile time
+- Added a compact option to reduce RAM per encoder (ENABLE_COMPACT)
+- Added debounced push switch and event callback (ENABLE_SWITCH)
+- Added readEvents() to return a batch of events in one call, with optional time stamps
+- Added step timing and polling instrumentation (ENABLE_TIMING)
+- Added moving average and exponential smoothing for the windowed speed (ENABLE_SPEED_SMOOTH)
+- Speed counts saturate instead of wrapping, with 32 bit counts as an option (ENABLE_WIDE_SPEED)
+- Added interpolated position between steps with positionAt() (ENABLE_INTERPOLATE)
+- Added timer tick sampler to poll the encoders at a fixed rate (ENABLE_TIMER)
+- Added pin change interrupt dispatcher shared by the encoders on a port (ENABLE_PCINT)
+- Added decode task with a lock-free snapshot for other cores and tasks (ENABLE_TASK)
+- Added index (Z) channel with homing, revolution count and step check (ENABLE_INDEX)
+- Added serialize(), restore() and the wear levelled EEPROM saver (ENABLE_PERSIST)
+- Added adaptive poll interval based on activity and speed (ENABLE_ADAPTIVE)
+
 Jul 2023 - version 1.0.2
 - Fixed documentation re interrupt driven use
 
@@ -96,8 +146,16 @@ direction or the other.
 
 It's also possible to use 'half-step' mode. This just emits an event at both the 
 0-0 and 1-1 positions. This might be useful for some encoders where you want to 
-detect all positions. In MD_REncoder.h set ENABLE_HALF_STEP to 1 to enable 
-half-step mode.
+detect all positions. 
+
+The 'quarter-step' mode emits an event at every valid change of output code (4 per 
+step), which gives the full resolution of optical encoders. Each state simply records 
+the last code, and a change of both bits at once is an invalid transition that only 
+resynchronizes the state without emitting an event. As there is no built-in debounce in 
+this mode, contact bounce shows up as pairs of opposite events that cancel out. 
+
+The step mode is selected for each encoder when the object 
+is created or with setStepMode().
 
 If an invalid state happens (for example we go from '0-1' straight to '1-0'), the 
 state machine resets to the start until 0-0 and the next valid codes occur.
@@ -116,8 +174,10 @@ state table and less than 10 lines of logic.
 Compile Time Switches
 ---------------------
 
-ENABLE_HALF_STEP is 0 by default. Set this to 1 to emit codes when the rotary encoder
-is at 11 as well as 00. The default is to emit codes only at 00.
+ENABLE_HALF_STEP is 0 by default. This sets the step mode used when none is given to the 
+constructor. Set this to 1 to make half-step mode (emit codes when the rotary encoder is 
+at 11 as well as 00) the default. The default is to emit codes only at 00. The step mode can
+be selected for each encoder independently of this setting.
 
 ENABLE_PULLUPS is set to 1 by default. Set this 0 if internal pullup resistors on the
 input pins are not required.
@@ -125,19 +185,442 @@ input pins are not required.
 ENABLE_SPEED is set to 1 by default. Set this to 0 to disable the code and storage used to 
 calculate the speed of the encoder rotation.
 
+ENABLE_SPEED_SMOOTH is set to 0 by default. Set this to 1 to include the smoothing filters 
+for the windowed speed described below.
+
+ENABLE_WIDE_SPEED is set to 0 by default. Set this to 1 to use 32 bit counts and speeds, as 
+described below.
+
+ENABLE_SPEED_INTERVAL is set to 0 by default. Set this to 1 to include the speed estimator
+based on the time between steps. This needs ENABLE_SPEED set to 1.
+
+ENABLE_POSITION is set to 1 by default. Set this to 0 to disable the code and storage used
+to accumulate the encoder position.
+
+ENABLE_ACCEL is set to 0 by default. Set this to 1 to include the acceleration curve and 
+position bounds described below. This needs ENABLE_SPEED and ENABLE_POSITION set to 1.
+
+ENABLE_HW_COUNTER is set to 0 by default. Set this to 1 to use a hardware quadrature counter
+peripheral, where the architecture has one that the library supports, as described below.
+
+ENABLE_FILTER is set to 0 by default. Set this to 1 to include the input glitch filter 
+described below.
+
+ENABLE_STATS is set to 0 by default. Set this to 1 to include the decoder statistics 
+described below.
+
+ENABLE_OVERRUN is set to 0 by default. Set this to 1 to include the missed edge detection 
+described below.
+
+ENABLE_COMPACT is set to 0 by default. Set this to 1 to reduce the RAM used by each encoder 
+object, as described in the RAM Usage section below.
+
+ENABLE_SWITCH is set to 0 by default. Set this to 1 to include the push switch and the 
+event callback described below.
+
+ENABLE_INDEX is set to 0 by default. Set this to 1 to include the index channel described 
+below. This needs ENABLE_POSITION.
+
+ENABLE_PERSIST is set to 0 by default. Set this to 1 to include the state snapshot for 
+saving and restoring the encoder described below. This needs ENABLE_POSITION.
+
+ENABLE_EVENT_TIME is set to 0 by default. Set this to 1 to time stamp the events returned 
+by readEvents(), as described below.
+
+ENABLE_TIMING is set to 0 by default. Set this to 1 to include the step timing 
+instrumentation described below.
+
+ENABLE_INTERPOLATE is set to 0 by default. Set this to 1 to include the interpolated 
+position described below. This needs ENABLE_SPEED, ENABLE_SPEED_INTERVAL and ENABLE_POSITION.
+
+ENABLE_FAST_IO is set to 1 by default. The port input registers and bit masks for the 
+encoder pins are resolved once in begin() and read() then reads the registers directly, 
+with a single register read when both pins are on the same port. Architectures that do 
+not provide the portInputRegister() and digitalPinToBitMask() mappings, and pins that 
+do not map to a port, automatically fall back to digitalRead(). Set this to 0 to always 
+use digitalRead().
+
+ENABLE_INTERRUPT is set to 0 by default. Set this to 1 to include the built-in interrupt
+driven mode described below.
+
+ENABLE_TIMER is set to 0 by default. Set this to 1 to include the timer tick sampler 
+described below. This needs ENABLE_INTERRUPT.
+
+ENABLE_PCINT is set to 0 by default. Set this to 1 to include the pin change interrupt 
+dispatcher described below. This needs ENABLE_INTERRUPT.
+
+ENABLE_TASK is set to 0 by default. Set this to 1 to include the decode task and shared 
+snapshot described below.
+
+ENABLE_ADAPTIVE is set to 0 by default. Set this to 1 to include the adaptive poll interval 
+described below.
+
+Interrupt Driven Mode
+---------------------
+When ENABLE_INTERRUPT is 1, calling begin(true) attaches a CHANGE interrupt to both encoder 
+pins. The interrupt handler runs the state table transition and places each DIR_CW or DIR_CCW 
+event into a small per-encoder queue of EVENT_QUEUE_SIZE entries. read() then removes events 
+from the queue rather than sampling the pins, so the decoding is independent of how often 
+loop() runs. The queue is single-producer (the interrupt handler) single-consumer (read()) and 
+does not need to disable interrupts. If the queue fills before it is read, further events are 
+discarded.
+
+Pin Change Interrupts
+---------------------
+When ENABLE_PCINT is 1 and a pin has no external interrupt, begin(true) uses the AVR pin 
+change interrupts instead, for up to MAX_PCINT_ENCODERS encoders. A pin change interrupt is 
+shared by all the pins in a port, so the library has one dispatcher for each port. It reads 
+the port once, compares it with the previous reading to find the pins that changed, and uses 
+a table from pin bit to encoder to run the state table only for the encoders with changed 
+pins. The time in the interrupt handler therefore depends on the number of pins that changed 
+rather than the number of encoders using the port.
+
+The library defines the PCINTn_vect handlers, so it cannot be used with other libraries that 
+also define them, such as SoftwareSerial. On processors without pin change interrupts, or 
+pins where the port and pin change bit numbers do not match, begin(true) returns false.
+
+Timer Tick Sampler
+------------------
+When ENABLE_TIMER is 1, encoders can be sampled from a timer interrupt at a fixed rate instead 
+of from loop() or pin change interrupts. beginSampler() starts the timer at the sample rate 
+given and attachSampler() adds an encoder (up to MAX_TIMER_ENCODERS) to the list sampled at 
+each tick. On each tick the state table is run for every attached encoder in the same way 
+as by isr(), and the events are queued for read() as in interrupt mode. The sample rate is 
+the highest edge rate that can be followed without missing states, however busy loop() is, 
+and any pins can be used.
+
+The built-in timer is Timer2 on AVR, which is also used by tone(), so the two cannot be used 
+together. On other architectures beginSampler() returns false, and tick() should be called 
+from an application timer interrupt at the rate required. The time spent in the interrupt 
+handler increases with the number of encoders attached.
+
+Decode Task
+-----------
+When ENABLE_TASK is 1, the decoding can be moved off the application core or out of loop(). 
+attachTask() adds an encoder (up to MAX_TASK_ENCODERS) to the list served by service(), which 
+calls read() until there are no more events for each attached encoder and then publishes the 
+position, speed and step count in a snapshot. The application gets a consistent copy of the 
+snapshot with getSnapshot() from any core or task. The snapshot is a sequence lock: service() 
+increments a sequence number before and after each update, and getSnapshot() copies the data 
+again if the number was odd or changed during the copy. Neither side waits for a mutex and 
+service() is never held up by the readers.
+
+On ESP32 beginTask() creates a FreeRTOS task pinned to the core given, which calls service() 
+at a fixed period. On other architectures beginTask() returns false and service() should be 
+called from the application's own task, or from loop1() on the second RP2040 core. Once an 
+encoder is attached read() must only be called by service(). Interrupt driven mode can be used 
+with the task, in which case service() empties the interrupt queues and the period only needs 
+to be short enough for the queues not to fill.
+
+Adaptive Poll Interval
+----------------------
+Polling at a fixed fast rate wastes power when the encoder is idle, and a fixed slow rate 
+loses steps when it is turned quickly. When ENABLE_ADAPTIVE is 1, pollInterval() recommends 
+the time until the next read(). Each time it is called, if A or B changed since the last call 
+the interval drops to the shortest set by setAdaptive(). If nothing changed, the interval 
+doubles, up to the longest set. With ENABLE_SPEED, while the speed is not 0 the interval is 
+instead the one that gives POLL_MARGIN polls for each edge at the measured speed, so that it 
+does not back off between the edges while the encoder is turning. A margin of 4 allows the 
+speed to double or more within one speed period without losing steps. The application then sleeps or does other work 
+for the interval. Changes are seen by the decoding in all modes, so with interrupt or timer 
+modes the interval tells how often read() is needed.
+
+Sleeping for the longest interval can miss the start of a turn, so a device that sleeps 
+should also wake on a pin change, such as with the interrupt or pin change interrupt modes 
+above. The first edges then bring the interval down at once.
+
+With the timer tick sampler, adaptSampler() works out the interval for each encoder attached 
+to it and sets the sample rate for the shortest one by calling beginSampler(). It should be 
+called regularly, for example every DEFAULT_POLL_MAX microseconds, and returns the rate so 
+that an application timer can be set where there is no built-in timer. A rate the built-in timer 
+cannot reach, such as below about 61 Hz for Timer2 at 16 MHz, leaves it at the last rate set.
+
+Batched Events
+--------------
+readEvents() copies all the pending events, up to the size of the caller's buffer, in one 
+call instead of one call to read() for each event. Each eventRec_t in the buffer has the 
+encoder id and the direction, and when ENABLE_EVENT_TIME is 1 also the micros() time of the 
+event (the time the interrupt handler decoded it in interrupt mode, otherwise the time of the 
+read). In interrupt mode the queue is copied from a snapshot of its head, so interrupts are 
+not disabled and events decoded during the copy are left for the next call. Otherwise the 
+pins are sampled as for read(). The speed, position and callbacks are updated as they would 
+be by read(). MD_REncoderBank::readEvents() returns the events for all the encoders in the 
+bank, with the encoder index as the id.
+
+Up to MAX_ISR_ENCODERS encoders can use the built-in interrupt handlers. Both pins must support
+external interrupts (see digitalPinToInterrupt()). If the interrupts cannot be attached, begin() 
+returns false and the encoder stays in polled mode. Applications that manage their own
+interrupts can instead call isr() from their handler and read() from loop().
+
+Glitch Filter and Statistics
+----------------------------
+The state table already rejects switch bounce, but in electrically noisy installations an 
+additional filter may be needed. When ENABLE_FILTER is 1, setFilter() sets how long a new 
+pin state must be stable before it is accepted, as a number of consecutive identical samples,
+a minimum dwell time in microseconds, or both. Samples that change back before being accepted
+are rejected as glitches. As the filter needs the pins to be sampled again to accept a change,
+it should be used in polled mode and not with pin change interrupts. The filter should be 
+set to the minimum that works, as it limits the maximum rotation speed that can be tracked.
+
+When ENABLE_STATS is 1, getStats() returns a stats_t structure with counts of 
+- invalid transitions, where both pins changed together,
+- glitches rejected by the filter,
+- resets, where the state table returned to its start state without emitting a step. 
+
+These help to tune the filter and show how noisy an installation is. clearStats() sets all
+the counters back to 0.
+
+Step Timing
+-----------
+When ENABLE_TIMING is 1 the library records when steps happen and how quickly they are read, 
+to check that the polling schedule keeps up with the encoder. getTiming() returns a timing_t 
+structure with
+- the micros() time of the last step,
+- the latency from decoding a step in the interrupt handler to reading it (last and maximum),
+- the longest gap between calls to read() or readEvents(),
+- the minimum, maximum and mean time between steps, leaving out gaps of TIMING_IDLE or more, 
+- a histogram of the times between steps in TIMING_BINS bins that double in width.
+
+The step times are recorded in the decoding context, which is the interrupt handler 
+in interrupt mode. clearTiming() restarts the measurements. The instrumentation adds 
+to the time taken by each step and each read(), so it should be left out of production 
+builds.
+
+Missed Edges
+------------
+If the encoder is not sampled often enough, both pins can change between two samples and a 
+Gray code state is missed. The state table treats this as an invalid transition and the step 
+is lost. When ENABLE_OVERRUN is 1 the direction and time of the last valid transition are 
+remembered, and a double transition while the encoder is moving is counted as an overrun 
+(getOverruns()). The encoder is taken to be moving for OVERRUN_TIMEOUT milliseconds after a 
+valid transition, so a noise pulse on an idle encoder is not taken as an overrun, and an 
+invalid transition forgets the direction. 
+The overrun count shows whether the encoder is being sampled often enough, so that polling 
+intervals and interrupt priorities can be set from data. If setOverrunRecovery(true) has been 
+used, the missed code is also assumed to be in the direction the encoder was moving and is 
+fed to the state table before the new code, so the step is not lost. This may occasionally 
+be wrong (eg, noise or a change of direction at the same time) and the default is to only 
+count overruns. When both ENABLE_OVERRUN and ENABLE_STATS are 1, only double transitions 
+when the encoder is not moving are counted as invalid.
+
+Host Builds
+-----------
+When ARDUINO is not defined the library includes MD_REncoder_Host.h in place of Arduino.h, 
+and can be compiled and run on a desktop computer. The pin levels and the clock are 
+simulated and are set with the static methods of MD_REncoderHost, so that recorded or 
+synthetic encoder signals can be run through the same code that runs on the board. The 
+Simulation example uses this to check the step counts for each step mode with clean, 
+bouncing and noisy signals and to measure the time taken by read(). Direct port reads, 
+interrupts and hardware counters are not available in a host build.
+
+Push Switch and Callbacks
+-------------------------
+Many encoders have a push switch on the shaft. When ENABLE_SWITCH is 1 the switch pin is set 
+with setSwitch() and is sampled and debounced by read(), so one call handles both the rotation 
+and the switch. When direct port reads are used and the switch is on the same port as A or B, 
+the same port read is used for all three pins. A change of the switch is accepted once it has 
+been stable for the debounce time set by setSwitchTiming().
+
+The function set with setCallback() is called from read() for each event:
+- EV_CW and EV_CCW for a step with the switch released,
+- EV_PRESS_CW and EV_PRESS_CCW for a step with the switch held (press and turn),
+- EV_PRESS when the switch is released, if it was not turned or long pressed,
+- EV_LONG_PRESS once when the switch has been held for the long press time without turning.
+
+read() still returns the step direction, so the callback and the return value can be used 
+together. The switch timing uses millis(), so read() reads the clock on each call when a 
+switch is set. The callback can be used without a switch to dispatch the rotation events.
+
+Index Channel
+-------------
+Industrial encoders have a third output, the index or Z channel, with one pulse per revolution. 
+When ENABLE_INDEX is 1 the index pin is set with setIndex() and is sampled with A and B, so it 
+works in polled, interrupt, pin change interrupt and timer modes (but not with a hardware 
+counter). The index is checked when A or B changes, so it does not need an interrupt of its 
+own. Moving clockwise, the index is crossed when the pin becomes 
+active. Moving counter-clockwise it is crossed when the pin becomes inactive. Those are the 
+same edge of the pulse, so the index is found at the same angle whichever way it is crossed.
+
+At each crossing the position is latched for getIndexPosition() and the revolution count from 
+getRevolutions() goes up or down by one. Crossing back over the index before a full revolution 
+is not counted. If the edges per revolution (4 for each line of the encoder) are given to 
+setIndex(), the A and B edges between crossings are checked against it. Each mismatch adds to 
+getIndexErrors() and the difference is kept in getIndexDrift(), so lost or extra edges are 
+found within one revolution. The check counts edges rather than steps because, in full and 
+half step modes, the step count between detents depends on the direction of approach. It is 
+not affected by the step mode, setPosition(), acceleration or bounds. A double transition is 
+left out of the count and so shows as drift.
+
+home() zeroes the position and the revolution count at the next crossing, giving a hardware 
+reference without a homing sweep. isHomed() is true once this has been done.
+
+Saving and Restoring State
+--------------------------
+When ENABLE_PERSIST is 1, serialize() copies the encoder state into a blob of PERSIST_SIZE 
+bytes and restore() puts it back, so the position does not have to be found again after a 
+reset. The blob has the step mode, the state table state and pins, the position, the filter 
+settings and, with ENABLE_INDEX, the revolution count and homed flag. It ends with a CRC-8, 
+and the first byte depends on the compile time switches, so restore() rejects a blob that is 
+corrupt or from a different build. Call restore() after begin(). The state table state is 
+only restored if the pins read the same as when it was saved, so a shaft moved while the 
+power was off starts cleanly from the new pins.
+
+MD_REncoderSaver (in MD_REncoderSaver.h) keeps the blob in EEPROM. Its update() method, called 
+from loop(), only writes when the state has changed and then not changed again for an idle 
+time, so nothing is written while the encoder is turning. Each write goes to the next of a 
+ring of slots with a sequence number, and a byte is only written if it is different, which 
+spreads the wear over the slots. begin() restores from the newest valid slot. On ESP32, 
+ESP8266 and RP2040 the EEPROM is emulated in flash, EEPROM.begin() must be called first with 
+a size covering all the slots, and update() commits each write.
+
+Hardware Counters
+-----------------
+Some microcontrollers have peripherals that count quadrature signals with no CPU load. When 
+ENABLE_HW_COUNTER is 1 and the architecture is supported, begin() sets up one of these 
+peripherals for the encoder pins. read(), speed() and the other methods work as usual, 
+but read() converts the hardware count into events (4, 2 or 1 counts per event for full, 
+half and quarter steps) instead of running the state table, returning one event for each 
+call. getPosition() and readDelta() read the hardware count themselves and add all the 
+steps counted to the position at once, so the position is up to date however often read() 
+is called. The events are only needed for the speed calculation and the callbacks, and the 
+timing of each step for the speed calculation is when read() sees it. If the peripheral 
+cannot be set up (eg, all the units are in use) the software decoder is used instead.  
+isHardware() tells which is in use.
+
+Supported peripherals are:
+- ESP32 family: pulse counter (PCNT) units. With ESP-IDF 5 and later (Arduino ESP32 core 
+3.x) the pulse_cnt driver is used, and the driver extends the 16 bit counter to 32 bits. 
+Earlier versions use the legacy pcnt driver, and the library takes the PCNT interrupt to 
+extend the count from the counter limit events, so the pcnt ISR service cannot be used 
+by other code. In both cases the count does not need to be read at any minimum rate, and 
+the hardware count is read and added to the position in a spinlock, so getPosition() can 
+be called by the application while read() runs in the decode task.
+
+Other architectures use the software decoder.
+
+Encoder Banks
+-------------
+Panels with many encoders can use the MD_REncoderBank class template (in MD_REncoderBank.h)
+instead of one MD_REncoder per encoder. The bank is sized at compile time for N encoders 
+(up to 32), samples each GPIO port used by the encoders only once per read() and then runs 
+the state table for every encoder in one loop. read() returns a bit mask of the encoders that 
+generated an event and event() returns the DIR_CW or DIR_CCW for each of them. The bank uses 
+the same state tables as MD_REncoder and falls back to digitalRead() for pins that cannot be 
+mapped to a port.
+
+Compile Time Encoders
+---------------------
+When the pins and step mode are known when the code is built, the MD_REncoderT class 
+template (in MD_REncoderT.h) can be used in place of MD_REncoder, for example 
+MD_REncoderT<2, 3, MD_REncoder::STEP_FULL> R. The pins, step mode and optional speed period 
+are template parameters, so they use no RAM and the compiler can resolve the pin reads and 
+the state table. On the ATmega328P family the pin reads are direct port bit reads and the 
+object is a single byte, which helps when there are many encoders on a small AVR. Position 
+counting, acceleration, filter, statistics and interrupts are not available, and the speed 
+is only calculated with the windowed method.
+
+RAM Usage
+---------
+The state tables are stored in PROGMEM, so they do not use any RAM. When ENABLE_COMPACT is 
+1 each encoder object saves some more RAM. The step mode is kept in the spare bits of the 
+state byte instead of a pointer to the state table, which is looked up on each transition, 
+and the speed calculation stores only the low 16 bits of the time stamp. On AVR the port 
+number of each pin is kept instead of the address of its input register, which is looked 
+up in PROGMEM on each read. The net count of clicks is only kept for its sign and 
+velocity() and velocityFloat() return speed() with the sign of the net direction of the 
+last period, so the speed smoothing also applies to them. This saves 10 bytes per encoder 
+on AVR, from 36 to 26 bytes with the default switches. As the time stamp wraps every 65 
+seconds, applications that use speed() with read() should call speed() or read(now) at 
+least that often. Applications with many encoders and no need for speed or position 
+should consider MD_REncoderBank or MD_REncoderT, which use only one byte per encoder.
+
+Position Counting
+-----------------
+Every step decoded is also added to (DIR_CW) or subtracted from (DIR_CCW) a signed 32 bit 
+position counter, whether or not the event returned by read() is used. getPosition() returns 
+the current position, setPosition() sets it and readDelta() returns the number of steps since 
+the last call to readDelta(). These methods are safe to use when the decoding is done in an 
+interrupt handler, so an application can check the encoder infrequently and still see every 
+step. When in interrupt mode, read() does not need to be called for the position to be 
+maintained.
+
+When ENABLE_INTERPOLATE is 1, positionAt() returns the position at a given micros() time 
+including a fraction of a step, extrapolated from the time of the last step and the average 
+time between steps. This lets a display or control loop that runs faster than the steps 
+arrive move smoothly between them. The fraction goes up to just before the next step, as 
+the encoder cannot have passed it without it being decoded, and is 0 once the encoder has 
+stalled (see setStallTimeout()), after a change of direction, or after a single step from 
+rest. The extrapolation assumes each step changes the position by 1, so it is less useful 
+with an acceleration curve.
+
+Acceleration
+------------
+When ENABLE_ACCEL is 1 an acceleration curve can be set with setAccelCurve(). Each step 
+then moves the position by a multiplier looked up from the curve using the current speed,
+so that turning the encoder quickly moves through large ranges of values while turning it 
+slowly still gives single steps. The curve is an array of accelPoint_t points in increasing
+order of speed, each giving the multiplier at that speed. The multiplier is interpolated 
+linearly between points, is the first point's multiplier below the first speed and the last
+point's multiplier above the last speed. The array is not copied and must persist. 
+makeAccelCurve() fills in an array with an exponential curve, which generally feels the 
+most natural. setBounds() limits the position to a range of values.
+
+The speed is taken from the step interval estimator when ENABLE_SPEED_INTERVAL is 1, which 
+responds to each step, and otherwise from the last complete speed sampling period.
+
 Speed Calculation
 -----------------
 The number of clicks is accumulated during the period defined by setPeriod(). Once the time 
 has expired the velocity is calculated in clicks per second by multiplying the number of 
 clicks by the number of periods in a second.
 
-speed = ClickCount * (1000 / period)
+speed = (ClickCount * 1000) / period
+
+The clock is not read by read() unless a step is decoded. The period that has expired is 
+closed off when the next step is counted or when the speed is requested, using the actual 
+elapsed time, and if more than two periods have elapsed since the last step the speed is 0. 
+Applications that already have the current millis() value can pass it to read(now), which 
+then does not need to read the clock at all.
+
+speed() returns the unsigned speed. velocity() returns the signed velocity (positive for 
+DIR_CW) in clicks per second in Q16.16 fixed point format, ie the value divided by 65536. 
+For the windowed method this uses the net count of clicks (CW less CCW) in the period. 
+velocityFloat() returns the same velocity as a float for applications that can afford the 
+floating point arithmetic.
+
+When ENABLE_SPEED_INTERVAL is 1 a second speed estimator is available, selected with 
+setSpeedMode(SPEED_INTERVAL). Each step decoded is timestamped with micros() and the speed 
+is calculated from a running average of the time between recent steps, so it is updated at 
+every step and has fine resolution at low speeds. If no step has been seen for longer 
+than the current average interval the elapsed time is used instead, so the speed decays 
+smoothly as the encoder slows down. The speed is 0 once no step has been seen for the stall 
+timeout set by setStallTimeout(), and the average restarts after a stall or a change of 
+direction.
+
+When ENABLE_SPEED_SMOOTH is 1 the windowed speed can be smoothed over several periods, 
+selected with setSpeedSmoothing(). SMOOTH_EMA is an exponential moving average where each 
+new period contributes alpha/256 of the result, and SMOOTH_AVERAGE is the mean of the last 
+N periods (up to SPEED_HISTORY). Periods that expire with no steps are added to the filter 
+as zero speed. The filters use integer arithmetic only, and allow a shorter period to be 
+used for a faster response without the speed jumping between values. The smoothing applies 
+to speed() (and so also to the acceleration) but not to velocity().
+
+The step counts for each period and the speed are 16 bit values by default, so speed() 
+returns at most 65535 clicks per second. All the speed arithmetic saturates at the limits and 
+does not wrap, so a fast encoder reads as the maximum speed. When ENABLE_WIDE_SPEED is 1 the 
+counts are 32 bits and speed() returns a 32 bit speed_t, for encoders on motor shafts or 
+hardware counters that step faster than this. The check for the end of a period is a single 
+subtraction and comparison on each step, and closing a period has a fixed cost.
 
 */
 #ifndef _MD_RENCODER_H
 #define _MD_RENCODER_H
 
+#if defined(ARDUINO)
 #include <Arduino.h>
+#else
+#include "MD_REncoder_Host.h"
+#endif
 /**
  * \file
  * \brief Main header file for the MD_Parola library
@@ -146,8 +629,8 @@ speed = ClickCount * (1000 / period)
 // Library options
 /**
  \def ENABLE_HALF_STEP
- Set this to 1 to emit codes when the rotary encoder is at 11 as well as 00. 
- The default is to emit codes only at 00.
+ Set this to 1 to make half-step mode (emit codes when the rotary encoder is at 11 as 
+ well as 00) the default step mode. The default is to emit codes only at 00.
  */
 #define ENABLE_HALF_STEP  0
 
@@ -163,6 +646,218 @@ speed = ClickCount * (1000 / period)
  */
 #define ENABLE_SPEED      1
 
+/**
+ \def ENABLE_SPEED_INTERVAL
+ Set this to 1 to include the speed estimator based on the time between steps.
+ */
+#define ENABLE_SPEED_INTERVAL 0
+
+/**
+ \def DEFAULT_STALL
+ Set the default stall timeout for the step interval speed estimator, in milliseconds.
+ */
+#define DEFAULT_STALL     250
+
+/**
+ \def ENABLE_SPEED_SMOOTH
+ Set this to 1 to include the smoothing filters for the windowed speed.
+ */
+#define ENABLE_SPEED_SMOOTH 0
+
+/**
+ \def SPEED_HISTORY
+ Set the maximum number of periods averaged by the SMOOTH_AVERAGE speed filter.
+ */
+#define SPEED_HISTORY     8
+
+/**
+ \def ENABLE_WIDE_SPEED
+ Set this to 1 to use 32 bit speed counts and results for high rate encoders.
+ */
+#define ENABLE_WIDE_SPEED 0
+
+/**
+ \def ENABLE_POSITION
+ Set this to 0 to disable the code and storage used to accumulate the encoder position.
+ */
+#define ENABLE_POSITION   1
+
+/**
+ \def ENABLE_ACCEL
+ Set this to 1 to include the speed based acceleration of the position.
+ */
+#define ENABLE_ACCEL      0
+
+#if ENABLE_ACCEL && !(ENABLE_SPEED && ENABLE_POSITION)
+#error "ENABLE_ACCEL needs ENABLE_SPEED and ENABLE_POSITION"
+#endif
+
+/**
+ \def ENABLE_INTERPOLATE
+ Set this to 1 to include the interpolated position between steps.
+ */
+#define ENABLE_INTERPOLATE 0
+
+#if ENABLE_INTERPOLATE && !(ENABLE_SPEED && ENABLE_SPEED_INTERVAL && ENABLE_POSITION)
+#error "ENABLE_INTERPOLATE needs ENABLE_SPEED, ENABLE_SPEED_INTERVAL and ENABLE_POSITION"
+#endif
+
+/**
+ \def ENABLE_FAST_IO
+ Set this to 0 to always use digitalRead() instead of direct port register reads.
+ */
+#define ENABLE_FAST_IO    1
+
+/**
+ \def ENABLE_FILTER
+ Set this to 1 to include the configurable input glitch filter.
+ */
+#define ENABLE_FILTER     0
+
+/**
+ \def ENABLE_STATS
+ Set this to 1 to include the counters for invalid transitions, glitches and resets.
+ */
+#define ENABLE_STATS      0
+
+/**
+ \def ENABLE_COMPACT
+ Set this to 1 to reduce the RAM used by each encoder, at the cost of a little speed.
+ */
+#define ENABLE_COMPACT    0
+
+/**
+ \def ENABLE_OVERRUN
+ Set this to 1 to include the missed edge detection and recovery.
+ */
+#define ENABLE_OVERRUN    0
+
+#if ENABLE_OVERRUN
+/**
+ \def OVERRUN_TIMEOUT
+ Time in milliseconds after the last valid transition that the encoder is taken to have stopped.
+ */
+#define OVERRUN_TIMEOUT   100
+#endif
+
+/**
+ \def ENABLE_SWITCH
+ Set this to 1 to include the encoder push switch and the event callback.
+ */
+#define ENABLE_SWITCH     0
+
+#if ENABLE_SWITCH
+/**
+ \def DEFAULT_DEBOUNCE
+ Default time in milliseconds the switch must be stable for a change to be accepted.
+ */
+#define DEFAULT_DEBOUNCE  20
+
+/**
+ \def DEFAULT_LONG_PRESS
+ Default time in milliseconds the switch must be held for a long press.
+ */
+#define DEFAULT_LONG_PRESS  1000
+
+/**
+ \def SW_NONE
+ setSwitch() pin number for no switch.
+ */
+#define SW_NONE   0xff
+#endif
+
+/**
+ \def ENABLE_INDEX
+ Set this to 1 to include the index (Z) channel. This needs ENABLE_POSITION.
+ */
+#define ENABLE_INDEX      0
+
+#if ENABLE_INDEX
+#if !ENABLE_POSITION
+#error "ENABLE_INDEX needs ENABLE_POSITION"
+#endif
+
+/**
+ \def INDEX_NONE
+ setIndex() pin number for no index channel.
+ */
+#define INDEX_NONE  0xff
+#endif
+
+/**
+ \def ENABLE_PERSIST
+ Set this to 1 to include serialize() and restore(). This needs ENABLE_POSITION.
+ */
+#define ENABLE_PERSIST    0
+
+#if ENABLE_PERSIST
+#if !ENABLE_POSITION
+#error "ENABLE_PERSIST needs ENABLE_POSITION"
+#endif
+
+/**
+ \def PERSIST_SIZE
+ Number of bytes written by serialize().
+ */
+#define PERSIST_SIZE  (7 + (ENABLE_FILTER ? 3 : 0) + (ENABLE_INDEX ? 5 : 0))
+#endif
+
+/**
+ \def ENABLE_EVENT_TIME
+ Set this to 1 to include a micros() time stamp in the events returned by readEvents().
+ */
+#define ENABLE_EVENT_TIME 0
+
+/**
+ \def ENABLE_TIMING
+ Set this to 1 to include the step timing and polling instrumentation.
+ */
+#define ENABLE_TIMING     0
+
+#if ENABLE_TIMING
+/**
+ \def TIMING_BINS
+ Number of bins in the step interval histogram. Bin 0 counts intervals below 256us 
+ and each following bin doubles the lower limit, with the last bin counting all 
+ the longer intervals.
+ */
+#define TIMING_BINS   10
+
+/**
+ \def TIMING_IDLE
+ Step intervals in microseconds at or above this are idle gaps and are not included 
+ in the minimum, maximum and mean step interval.
+ */
+#define TIMING_IDLE   100000UL
+#endif
+
+/**
+ \def ENABLE_HW_COUNTER
+ Set this to 1 to use a hardware quadrature counter where the architecture has one.
+ */
+#define ENABLE_HW_COUNTER 0
+
+// Hardware counters are only available on some architectures
+#if ENABLE_HW_COUNTER && defined(ARDUINO_ARCH_ESP32)
+#define RE_HW_COUNTER 1
+#else
+#define RE_HW_COUNTER 0
+#endif
+
+// Fast I/O is only possible if the core provides the pin to port mappings
+#if ENABLE_FAST_IO && defined(portInputRegister) && defined(digitalPinToPort) && defined(digitalPinToBitMask)
+#define RE_FAST_IO  1
+#else
+#define RE_FAST_IO  0
+#endif
+
+// Compact objects on AVR keep the port number of each pin and not the register address
+#if RE_FAST_IO && ENABLE_COMPACT && defined(__AVR__)
+#define RE_PORT_INDEX 1
+#else
+#define RE_PORT_INDEX 0
+#endif
+
 /**
  Set the default sampling period for measuring the speed, in milliseconds. This works best as 
  a whole fraction of 1000 (ie 100, 200, 500, 1000). Longer periods provide some hysteresis 
@@ -170,6 +865,124 @@ speed = ClickCount * (1000 / period)
  */
 #define DEFAULT_PERIOD    500
 
+/**
+ \def ENABLE_INTERRUPT
+ Set this to 1 to include the built-in interrupt handlers and event queue.
+ */
+#define ENABLE_INTERRUPT  0
+
+#if ENABLE_INTERRUPT
+/**
+ \def EVENT_QUEUE_SIZE
+ Number of entries in each encoder's event queue in interrupt mode. This must be a power of 2
+ and one entry is always kept free, so a queue holds EVENT_QUEUE_SIZE-1 events.
+ */
+#define EVENT_QUEUE_SIZE  8
+
+/**
+ \def MAX_ISR_ENCODERS
+ Maximum number of encoders that can use the built-in interrupt handlers (1 to 4).
+ */
+#define MAX_ISR_ENCODERS  4
+#endif
+
+// ISR code needs to be in RAM on some architectures
+#ifdef IRAM_ATTR
+#define RE_ISR_ATTR IRAM_ATTR
+#else
+#define RE_ISR_ATTR
+#endif
+
+/**
+ \def ENABLE_TIMER
+ Set this to 1 to include the timer tick sampler. This needs ENABLE_INTERRUPT.
+ */
+#define ENABLE_TIMER      0
+
+#if ENABLE_TIMER
+#if !ENABLE_INTERRUPT
+#error "ENABLE_TIMER needs ENABLE_INTERRUPT"
+#endif
+
+/**
+ \def MAX_TIMER_ENCODERS
+ Maximum number of encoders that can be attached to the timer tick sampler.
+ */
+#define MAX_TIMER_ENCODERS  8
+#endif
+
+/**
+ \def ENABLE_PCINT
+ Set this to 1 to use pin change interrupts for pins without an external 
+ interrupt. This needs ENABLE_INTERRUPT.
+ */
+#define ENABLE_PCINT      0
+
+#if ENABLE_PCINT
+#if !ENABLE_INTERRUPT
+#error "ENABLE_PCINT needs ENABLE_INTERRUPT"
+#endif
+
+/**
+ \def MAX_PCINT_ENCODERS
+ Maximum number of encoders that can use the pin change interrupt dispatcher.
+ */
+#define MAX_PCINT_ENCODERS  8
+
+// Number of pin change interrupt groups (ports) on this processor
+#if defined(PCINT3_vect)
+#define RE_PCINT_GROUPS 4
+#elif defined(PCINT2_vect)
+#define RE_PCINT_GROUPS 3
+#elif defined(PCINT1_vect)
+#define RE_PCINT_GROUPS 2
+#elif defined(PCINT0_vect)
+#define RE_PCINT_GROUPS 1
+#else
+#define RE_PCINT_GROUPS 0
+#endif
+#endif
+
+/**
+ \def ENABLE_TASK
+ Set this to 1 to include the decode task and the shared snapshot.
+ */
+#define ENABLE_TASK       0
+
+#if ENABLE_TASK
+/**
+ \def MAX_TASK_ENCODERS
+ Maximum number of encoders that can be attached to the decode task.
+ */
+#define MAX_TASK_ENCODERS 8
+#endif
+
+/**
+ \def ENABLE_ADAPTIVE
+ Set this to 1 to include the adaptive poll interval.
+ */
+#define ENABLE_ADAPTIVE   0
+
+#if ENABLE_ADAPTIVE
+/**
+ \def DEFAULT_POLL_MIN
+ Default shortest poll interval in microseconds, used while the encoder is turning.
+ */
+#define DEFAULT_POLL_MIN  250
+
+/**
+ \def DEFAULT_POLL_MAX
+ Default longest poll interval in microseconds, reached while the encoder is idle.
+ */
+#define DEFAULT_POLL_MAX  100000UL
+
+/**
+ \def POLL_MARGIN
+ Number of polls for each edge at the measured speed.
+ */
+#define POLL_MARGIN       4
+#endif
+
 
 //  Direction values returned by read() method 
 /**
@@ -188,46 +1001,619 @@ speed = ClickCount * (1000 / period)
  */
 #define DIR_CCW   0x20  
 
+template <uint8_t N> class MD_REncoderBank;
+template <uint8_t PIN_A, uint8_t PIN_B, uint8_t MODE, uint16_t PERIOD> class MD_REncoderT;
+
 /**
  * Core object for the MD_REncoder library
  */
 class MD_REncoder
 {
   public:
-  /** 
-   * Class Constructor.
+  /**
+   * Step mode enumerated type specification.
    *
-   * Instantiate a new instance of the class. 
+   * Used to select the state table used to decode the encoder outputs.
+   */
+    enum stepMode_t
+    {
+      STEP_FULL,  ///< Full-step, emit codes at 00 only
+      STEP_HALF,  ///< Half-step, emit codes at 00 and 11
+      STEP_QUARTER, ///< Quarter-step, emit codes at every valid transition
+    };
+
+  /**
+   * Speed mode enumerated type specification.
    *
-   * \param pinA  the pin number for the encoder A output
-   * \param pinB  the pin number for the encoder B output
+   * Used to select the method used to calculate the encoder speed.
    */
-    MD_REncoder(uint8_t pinA, uint8_t pinB);
+    enum speedMode_t
+    {
+      SPEED_WINDOW,   ///< Count the steps in each sampling period
+      SPEED_INTERVAL, ///< Use the time between steps (needs ENABLE_SPEED_INTERVAL)
+    };
 
-  /** 
-   * Initialize the object.
+  /**
+   * Speed type, 16 bits or 32 bits when ENABLE_WIDE_SPEED is 1.
+   */
+#if ENABLE_WIDE_SPEED
+    typedef uint32_t speed_t;
+#else
+    typedef uint16_t speed_t;
+#endif
+
+  /**
+   * Speed smoothing enumerated type specification.
    *
-   * Initialize the object data. This will be called to initialize 
-   * new data for the class that cannot be done during the object creation.
+   * Used to select the filter applied to the windowed speed.
    */
-    void begin(void);
+    enum smooth_t
+    {
+      SMOOTH_NONE,    ///< Speed for the last period only
+      SMOOTH_EMA,     ///< Exponential moving average of the periods
+      SMOOTH_AVERAGE, ///< Mean of the last N periods
+    };
 
-  /** 
-   * Read the direction of rotation.
+#if ENABLE_STATS
+  /**
+   * Decoder statistics.
    *
-   * Read the direction of rotation inferred from the previous state of the 
-   * encoder the current state of the inputs. This method should be called 
-   * on a frequent regular basis to ensure smooth encoder inputs.
+   * Returned by getStats().
+   */
+    struct stats_t
+    {
+      uint32_t invalid;   ///< transitions where both pins changed together
+      uint32_t glitches;  ///< pin changes rejected by the glitch filter
+      uint32_t resets;    ///< returns to the start state without emitting a step
+    };
+#endif
+
+#if ENABLE_SWITCH
+  /**
+   * Callback event enumerated type specification.
    *
-   * \return One of the DIR_NONE, DIR_CW or DIR_CCW.
+   * Passed to the function set with setCallback().
    */
-    uint8_t read(void);
+    enum event_t
+    {
+      EV_CW,          ///< Clockwise step with the switch released
+      EV_CCW,         ///< Counter-clockwise step with the switch released
+      EV_PRESS,       ///< Switch pressed and released
+      EV_LONG_PRESS,  ///< Switch held for the long press time
+      EV_PRESS_CW,    ///< Clockwise step with the switch held
+      EV_PRESS_CCW,   ///< Counter-clockwise step with the switch held
+    };
 
-#if ENABLE_SPEED
-  /** 
-   * Set the sampling period for the speed detection.
+  /**
+   * Event callback function type.
    *
-   * Set the speed sampling interval in milliseconds. The period 
+   * The callback is passed the encoder object and the event.
+   */
+    typedef void (*cbEvent_t)(MD_REncoder &re, event_t ev);
+#endif
+
+  /**
+   * Event record.
+   *
+   * Returned by readEvents().
+   */
+    struct eventRec_t
+    {
+      uint8_t id;     ///< encoder id
+      uint8_t dir;    ///< DIR_CW or DIR_CCW
+#if ENABLE_EVENT_TIME
+      uint32_t time;  ///< micros() time of the event
+#endif
+    };
+
+#if ENABLE_TIMING
+  /**
+   * Step timing data.
+   *
+   * Returned by getTiming(). All times are in microseconds.
+   */
+    struct timing_t
+    {
+      uint32_t lastStep;      ///< micros() time of the last step
+      uint32_t latencyLast;   ///< decode to read time of the last step read (interrupt mode)
+      uint32_t latencyMax;    ///< longest decode to read time (interrupt mode)
+      uint32_t pollGapMax;    ///< longest time between calls to read() or readEvents()
+      uint32_t intervalMin;   ///< shortest time between steps
+      uint32_t intervalMax;   ///< longest time between steps, less than TIMING_IDLE
+      uint32_t intervalMean;  ///< mean time between steps, less than TIMING_IDLE
+      uint16_t hist[TIMING_BINS]; ///< times between steps, bin 0 below 256us then doubling
+    };
+#endif
+
+#if ENABLE_TASK
+  /**
+   * Encoder snapshot.
+   *
+   * Published by service() and returned by getSnapshot().
+   */
+    struct snapshot_t
+    {
+      uint32_t count; ///< number of steps decoded
+      uint8_t dir;    ///< DIR_CW or DIR_CCW for the last step, DIR_NONE if none yet
+#if ENABLE_POSITION
+      int32_t position; ///< position counter
+#endif
+#if ENABLE_SPEED
+      speed_t speed;  ///< speed in clicks per second
+#endif
+    };
+#endif
+
+#if ENABLE_ACCEL
+  /**
+   * Acceleration curve point.
+   *
+   * An acceleration curve is an array of these in increasing order of speed.
+   */
+    struct accelPoint_t
+    {
+      uint16_t speed; ///< speed in clicks per second
+      uint16_t mult;  ///< position change for each step at this speed
+    };
+#endif
+
+  /** 
+   * Class Constructor.
+   *
+   * Instantiate a new instance of the class. 
+   *
+   * \param pinA  the pin number for the encoder A output
+   * \param pinB  the pin number for the encoder B output
+   * \param mode  the step mode for this encoder, defaults to the ENABLE_HALF_STEP setting
+   */
+    MD_REncoder(uint8_t pinA, uint8_t pinB, stepMode_t mode = (ENABLE_HALF_STEP ? STEP_HALF : STEP_FULL));
+
+  /** 
+   * Initialize the object.
+   *
+   * Initialize the object data. This will be called to initialize 
+   * new data for the class that cannot be done during the object creation.
+   */
+    void begin(void);
+
+  /** 
+   * Initialize the object, optionally in interrupt driven mode.
+   *
+   * Initialize the object data as for begin(void). If useInterrupt is true and 
+   * ENABLE_INTERRUPT is enabled, CHANGE interrupts are also attached to both 
+   * encoder pins and read() returns the events queued by the interrupt handler.
+   * With ENABLE_PCINT, pin change interrupts are used if the pins have no 
+   * external interrupt.
+   *
+   * \param useInterrupt true to run the encoder in interrupt driven mode.
+   * \return true if the encoder is running in the requested mode, false if the 
+   * interrupts could not be attached and the encoder is in polled mode.
+   */
+    bool begin(bool useInterrupt);
+
+  /** 
+   * Read the direction of rotation.
+   *
+   * Read the direction of rotation inferred from the previous state of the 
+   * encoder the current state of the inputs. This method should be called 
+   * on a frequent regular basis to ensure smooth encoder inputs.
+   *
+   * \return One of the DIR_NONE, DIR_CW or DIR_CCW.
+   */
+    uint8_t read(void);
+
+  /** 
+   * Read the direction of rotation using a supplied timestamp.
+   *
+   * Same as read(void), but the speed calculation uses the time supplied 
+   * instead of reading the clock. This is useful when the application already
+   * has the current time, for example when polling many encoders in one loop.
+   *
+   * \param now the current time as returned by millis().
+   * \return One of the DIR_NONE, DIR_CW or DIR_CCW.
+   */
+    uint8_t read(uint32_t now);
+
+  /** 
+   * Read all the pending events.
+   *
+   * Copy the pending events into buf, up to max of them. This is the same as 
+   * calling read() until it returns DIR_NONE, but in interrupt mode the queue is
+   * copied in one pass. Any events not copied are left for the next call.
+   *
+   * \param buf the array to receive the events.
+   * \param max the number of entries in buf.
+   * \param id  the id to put in the events, defaults to 0.
+   * \return The number of events copied to buf.
+   */
+    uint8_t readEvents(eventRec_t *buf, uint8_t max, uint8_t id = 0);
+
+  /** 
+   * Check if the encoder is idle.
+   *
+   * In polled mode the encoder is idle if the pins did not change at the last
+   * read(). Unchanged pins cannot change the decoder state, so read() returns 
+   * DIR_NONE immediately in this case. In interrupt mode the encoder is idle
+   * when there are no queued events. A scheduler can use this to decide how 
+   * often the encoder needs attention.
+   *
+   * \return true if the encoder is idle.
+   */
+    bool isIdle(void);
+
+  /** 
+   * Set the step mode.
+   *
+   * Change the state table used to decode the encoder outputs. The
+   * decoder restarts from its initial state.
+   *
+   * \param mode one of the stepMode_t values.
+   */
+    void setStepMode(stepMode_t mode);
+
+  /** 
+   * Get the step mode.
+   *
+   * \return The stepMode_t value for the state table in use.
+   */
+    stepMode_t getStepMode(void);
+
+#if ENABLE_INTERRUPT
+  /** 
+   * Interrupt handler for the encoder.
+   *
+   * Sample the encoder pins, run the state table transition and queue any 
+   * resulting event for read(). This is called by the built-in interrupt handlers
+   * when begin(true) is used, but can also be called from an application's own 
+   * pin change interrupt handler. It must not be called concurrently with itself.
+   */
+    void RE_ISR_ATTR isr(void);
+
+  /** 
+   * Check if the encoder is running in interrupt driven mode.
+   *
+   * \return true if read() is returning events from the interrupt queue.
+   */
+    inline bool isInterrupt(void) { return(_isr); };
+
+#if ENABLE_PCINT
+  /** 
+   * Dispatch a pin change interrupt.
+   *
+   * This is called by the built-in pin change interrupt handlers to update 
+   * the encoders with pins that changed in the port for that interrupt.
+   *
+   * \param group the pin change interrupt number (PCINTn_vect).
+   */
+    static void RE_ISR_ATTR pcint(uint8_t group);
+#endif
+
+#if ENABLE_TIMER
+  /** 
+   * Start the timer tick sampler.
+   *
+   * Set up the built-in timer to call tick() rate times a second. On AVR 
+   * this uses Timer2, and rates from about F_CPU/262144 to F_CPU/2 Hz are 
+   * possible.
+   *
+   * \param rate the samples per second.
+   * \return true if the built-in timer is available and was started.
+   */
+    static bool beginSampler(uint16_t rate);
+
+  /** 
+   * Attach this encoder to the timer tick sampler.
+   *
+   * The encoder is sampled on each tick and read() returns the queued 
+   * events. Call this after begin(false).
+   *
+   * \return false if the encoder is already in interrupt mode or the 
+   * sampler has MAX_TIMER_ENCODERS attached.
+   */
+    bool attachSampler(void);
+
+  /** 
+   * Sample all the encoders attached to the timer tick sampler.
+   *
+   * This is called by the built-in timer interrupt handler. Where there is no 
+   * built-in timer, call it from an application timer interrupt handler.
+   */
+    static void RE_ISR_ATTR tick(void);
+
+#if ENABLE_ADAPTIVE
+  /** 
+   * Adapt the timer tick sample rate.
+   *
+   * Set the sample rate from the shortest pollInterval() of the encoders 
+   * attached to the timer tick sampler, if it has changed.
+   *
+   * \return The sample rate in samples per second.
+   */
+    static uint16_t adaptSampler(void);
+#endif
+#endif
+#endif
+
+#if ENABLE_TASK
+  /** 
+   * Attach this encoder to the decode task.
+   *
+   * The encoder is read by service() and the results are returned by 
+   * getSnapshot(). Call this after begin().
+   *
+   * \return false if MAX_TASK_ENCODERS are already attached.
+   */
+    bool attachTask(void);
+
+  /** 
+   * Start the decode task.
+   *
+   * Create a task that calls service() every period milliseconds. This is 
+   * only available on ESP32, where the task is pinned to the core given.
+   *
+   * \param period   the time between calls to service() in milliseconds.
+   * \param core     the core to run the task on.
+   * \param priority the FreeRTOS priority for the task.
+   * \return true if the task was created.
+   */
+    static bool beginTask(uint16_t period, uint8_t core, uint8_t priority);
+
+  /** 
+   * Decode all the encoders attached to the decode task.
+   *
+   * Read all the pending events for each attached encoder and publish the 
+   * new snapshot. This is called by the task created by beginTask(), or 
+   * from the application's own task or core. It must not be called 
+   * concurrently with itself.
+   */
+    static void service(void);
+
+  /** 
+   * Get the latest snapshot.
+   *
+   * Copy the last snapshot published by service(). This does not block and 
+   * can be called from any core or task.
+   *
+   * \param s the snapshot_t to receive the data.
+   */
+    void getSnapshot(snapshot_t &s);
+#endif
+
+#if ENABLE_FILTER
+  /** 
+   * Set the input glitch filter.
+   *
+   * A change in the pin state is only accepted once the new state has been 
+   * seen in the number of consecutive samples and for the minimum time given.
+   * Setting both to 0 disables the filter, which is the default.
+   *
+   * \param samples the number of identical samples needed, 0 or 1 for no count.
+   * \param dwell   the minimum time in microseconds, 0 for no minimum.
+   */
+    void setFilter(uint8_t samples, uint16_t dwell);
+#endif
+
+#if ENABLE_STATS
+  /** 
+   * Get the decoder statistics.
+   *
+   * Copy the current values of the counters.
+   *
+   * \param stats the structure to receive the values.
+   */
+    void getStats(stats_t &stats);
+
+  /** 
+   * Clear the decoder statistics.
+   */
+    void clearStats(void);
+#endif
+
+#if ENABLE_TIMING
+  /** 
+   * Get the step timing data.
+   *
+   * Copy the current values of the timing data.
+   *
+   * \param timing the structure to receive the values.
+   */
+    void getTiming(timing_t &timing);
+
+  /** 
+   * Clear the step timing data.
+   */
+    void clearTiming(void);
+#endif
+
+#if ENABLE_OVERRUN
+  /** 
+   * Set missed edge recovery.
+   *
+   * When recovery is enabled, a transition where both pins changed while the 
+   * encoder is moving is decoded as two transitions in the direction of movement. 
+   * Otherwise it is only counted. Recovery is disabled by default.
+   *
+   * \param b true to enable recovery.
+   */
+    inline void setOverrunRecovery(bool b) { _recover = b; };
+
+  /** 
+   * Get the overrun count.
+   *
+   * \return The number of double transitions seen while the encoder was moving.
+   */
+    uint32_t getOverruns(void);
+
+  /** 
+   * Clear the overrun count.
+   */
+    void clearOverruns(void);
+#endif
+
+#if ENABLE_SWITCH
+  /** 
+   * Set the push switch pin.
+   *
+   * The pin is set up as an input, with the pullup if ENABLE_PULLUPS is 1.
+   *
+   * \param pin    the pin number for the switch, or SW_NONE for no switch.
+   * \param active the pin level when the switch is pressed, LOW (default) or HIGH.
+   */
+    void setSwitch(uint8_t pin, uint8_t active = LOW);
+
+  /** 
+   * Set the push switch timing.
+   *
+   * \param debounce  the time in ms the switch must be stable for a change to be accepted.
+   * \param longPress the time in ms the switch must be held for a long press.
+   */
+    inline void setSwitchTiming(uint8_t debounce, uint16_t longPress) { _swDebounce = debounce; _swLong = longPress; };
+
+  /** 
+   * Set the event callback.
+   *
+   * The callback is called from read() for each step and switch event.
+   *
+   * \param cb the callback function, or NULL for none.
+   */
+    inline void setCallback(cbEvent_t cb) { _callback = cb; };
+
+  /** 
+   * Check if the switch is pressed.
+   *
+   * \return true if the debounced switch is pressed.
+   */
+    inline bool isPressed(void) { return((_swFlags & SW_PRESSED) != 0); };
+#endif
+
+#if ENABLE_INDEX
+  /** 
+   * Set the index (Z) pin.
+   *
+   * The pin is set up as an input, with the pullup if ENABLE_PULLUPS is 1. If
+   * cpr is not 0, the edges between index crossings are checked against it.
+   * The revolution count and the index errors are not changed.
+   *
+   * \param pin    the pin number for the index, or INDEX_NONE for no index.
+   * \param active the pin level during the index pulse, HIGH (default) or LOW.
+   * \param cpr    the edges per revolution (4 per line), 0 for no check.
+   */
+    void setIndex(uint8_t pin, uint8_t active = HIGH, uint16_t cpr = 0);
+
+  /** 
+   * Home at the next index crossing.
+   *
+   * The position and the revolution count are set to 0 when the index is 
+   * next crossed.
+   */
+    void home(void);
+
+  /** 
+   * Check if the position has been homed.
+   *
+   * \return true if the position has been zeroed at an index crossing since home().
+   */
+    inline bool isHomed(void) { return((_zFlags & IDX_HOMED) != 0); };
+
+  /** 
+   * Get the revolution count.
+   *
+   * \return The number of index crossings clockwise less those counter-clockwise.
+   */
+    int32_t getRevolutions(void);
+
+  /** 
+   * Get the index position.
+   *
+   * \return The position at the last index crossing.
+   */
+    int32_t getIndexPosition(void);
+
+  /** 
+   * Get the index error count.
+   *
+   * \return The number of revolutions that did not have the edges set by setIndex().
+   */
+    inline uint16_t getIndexErrors(void) { return(_zErrors); };
+
+  /** 
+   * Get the last index error.
+   *
+   * \return The edges counted less the edges expected for the last revolution in error.
+   */
+    inline int16_t getIndexDrift(void) { return(_zDrift); };
+#endif
+
+#if ENABLE_ADAPTIVE
+  /** 
+   * Set the adaptive poll interval limits.
+   *
+   * \param minInterval the shortest interval in microseconds, used while turning.
+   * \param maxInterval the longest interval in microseconds, reached while idle.
+   */
+    inline void setAdaptive(uint16_t minInterval, uint32_t maxInterval) { _adMin = minInterval; _adMax = maxInterval; };
+
+  /** 
+   * Get the recommended poll interval.
+   *
+   * Work out the time until read() should next be called from the activity 
+   * since the last call and the speed. Each idle call doubles the interval.
+   *
+   * \return The poll interval in microseconds.
+   */
+    uint32_t pollInterval(void);
+#endif
+
+#if ENABLE_PERSIST
+  /** 
+   * Save the encoder state.
+   *
+   * Copy the step mode, decoder state, position and settings into buf.
+   *
+   * \param buf  the buffer to receive the state.
+   * \param size the size of buf, at least PERSIST_SIZE.
+   * \return The number of bytes written, 0 if buf is too small.
+   */
+    uint8_t serialize(uint8_t *buf, uint8_t size);
+
+  /** 
+   * Check a saved encoder state.
+   *
+   * Check the tag, CRC, step mode and decoder state of a state saved by serialize(), without 
+   * changing any encoder.
+   *
+   * \param buf the saved state.
+   * \param len the number of bytes in buf.
+   * \return true if the state is valid and can be restored.
+   */
+    static bool isValid(const uint8_t *buf, uint8_t len);
+
+  /** 
+   * Restore the encoder state.
+   *
+   * Restore the state saved by serialize(). This should be called after begin().
+   *
+   * \param buf the saved state.
+   * \param len the number of bytes in buf.
+   * \return true if the state was valid and has been restored.
+   */
+    bool restore(const uint8_t *buf, uint8_t len);
+#endif
+
+#if RE_HW_COUNTER
+  /** 
+   * Check if the encoder is using a hardware counter.
+   *
+   * \return true if the encoder is counted by a hardware peripheral.
+   */
+    inline bool isHardware(void) { return(_hwUnit >= 0); };
+#endif
+
+#if ENABLE_SPEED
+  /** 
+   * Set the sampling period for the speed detection.
+   *
+   * Set the speed sampling interval in milliseconds. The period 
    * must be greater than 0 and less than 1000. This works best as
    * a whole fraction of 1000 (ie 100, 200, 500, 1000). Longer 
    * periods provide some hysteresis which is useful when the 
@@ -247,24 +1633,483 @@ class MD_REncoder
    *
    * \return The speed in clicks per second.
    */
-    inline uint16_t speed(void) { return(_spd); };
+#if ENABLE_SPEED_INTERVAL
+    inline speed_t speed(void) { return(_speedMode == SPEED_INTERVAL ? speedInterval() : speedWindow()); };
+#else
+    inline speed_t speed(void) { return(speedWindow()); };
+#endif
+
+  /** 
+   * Return the signed velocity of the encoder.
+   *
+   * Calculate the velocity of the encoder using the method selected for
+   * speed(). The value is positive for DIR_CW and negative for DIR_CCW
+   * rotation.
+   *
+   * \return The velocity in clicks per second as a Q16.16 fixed point number.
+   */
+    int32_t velocity(void);
+
+  /** 
+   * Return the signed velocity of the encoder as a float.
+   *
+   * Same as velocity() but the result is a floating point number.
+   *
+   * \return The velocity in clicks per second.
+   */
+    float velocityFloat(void);
+
+#if ENABLE_SPEED_INTERVAL
+  /** 
+   * Set the speed calculation method.
+   *
+   * Select how speed() is calculated. SPEED_WINDOW, the default, counts the steps
+   * in each sampling period. SPEED_INTERVAL uses the time between recent steps.
+   *
+   * \param mode one of the speedMode_t values.
+   */
+    inline void setSpeedMode(speedMode_t mode) { _speedMode = mode; };
+
+  /** 
+   * Set the stall timeout for the step interval speed.
+   *
+   * If no step is seen for this time the step interval speed is 0.
+   * The default is DEFAULT_STALL.
+   *
+   * \param t time in milliseconds, greater than 0.
+   */
+    inline void setStallTimeout(uint16_t t) { if (t != 0) _stall = t; };
+#endif
+
+#if ENABLE_SPEED_SMOOTH
+  /** 
+   * Set the windowed speed smoothing.
+   *
+   * Select the filter applied to the speed calculated for each period. 
+   * The filter is restarted from zero speed. The default is SMOOTH_NONE.
+   *
+   * \param mode  one of the smooth_t values.
+   * \param param for SMOOTH_EMA the weight of each new period in 1/256 (1 to 255), 
+   * for SMOOTH_AVERAGE the number of periods (1 to SPEED_HISTORY).
+   */
+    void setSpeedSmoothing(smooth_t mode, uint8_t param);
+#endif
+#endif
+
+#if ENABLE_POSITION
+  /** 
+   * Return the encoder position.
+   *
+   * The position is incremented for every DIR_CW step and decremented for every 
+   * DIR_CCW step decoded. This is safe to call when the encoder is being decoded
+   * in an interrupt handler.
+   *
+   * \return The signed position count.
+   */
+    int32_t getPosition(void);
+
+  /** 
+   * Set the encoder position.
+   *
+   * Set the position counter to a new value. This also clears the change 
+   * returned by the next readDelta().
+   *
+   * \param pos the new position value.
+   */
+    void setPosition(int32_t pos);
+
+  /** 
+   * Return the change in encoder position.
+   *
+   * Return the number of steps (positive for DIR_CW, negative for DIR_CCW)
+   * decoded since the last call to readDelta() or setPosition(). The value 
+   * is read and cleared as one operation that is safe to call when the encoder 
+   * is being decoded in an interrupt handler.
+   *
+   * \return The signed change in position.
+   */
+    int32_t readDelta(void);
+#endif
+
+#if ENABLE_INTERPOLATE
+  /** 
+   * Return the interpolated encoder position.
+   *
+   * Extrapolate the position at time t from the last step and the average 
+   * time between steps. The position is floor(position) and frac is the 
+   * fraction of a step above it, so the position is the return value plus 
+   * frac/65536.
+   *
+   * \param t    the time as returned by micros(), normally the current time.
+   * \param frac the fraction of a step in 1/65536, 0 to 65535.
+   * \return The whole steps of the position.
+   */
+    int32_t positionAt(uint32_t t, uint16_t &frac);
+
+  /** 
+   * Return the interpolated encoder position as a float.
+   *
+   * Same as positionAt() but the result is a floating point number.
+   *
+   * \param t the time as returned by micros().
+   * \return The position in steps.
+   */
+    float positionAtFloat(uint32_t t);
+#endif
+
+#if ENABLE_ACCEL
+  /** 
+   * Set the acceleration curve.
+   *
+   * Each step changes the position by the multiplier looked up from the curve
+   * using the current speed. The array is not copied and must remain in scope.
+   *
+   * \param curve array of points in increasing order of speed, NULL for no acceleration.
+   * \param n     the number of points in the array.
+   */
+    void setAccelCurve(const accelPoint_t *curve, uint8_t n);
+
+  /** 
+   * Create an exponential acceleration curve.
+   *
+   * Fill in n points with speeds evenly spaced from 0 to speedMax and 
+   * multipliers growing exponentially from 1 to multMax. This can be 
+   * used to initialise the array passed to setAccelCurve().
+   *
+   * \param curve    array of n points to fill in.
+   * \param n        the number of points in the array, at least 2.
+   * \param speedMax the speed for the last point, in clicks per second.
+   * \param multMax  the multiplier for the last point.
+   */
+    static void makeAccelCurve(accelPoint_t *curve, uint8_t n, uint16_t speedMax, uint16_t multMax);
+
+  /** 
+   * Set the position bounds.
+   *
+   * Limit the position to the range min to max inclusive. The current position 
+   * is adjusted if it is outside the range.
+   *
+   * \param min the lowest position value.
+   * \param max the highest position value.
+   */
+    void setBounds(int32_t min, int32_t max);
+
+  /** 
+   * Remove the position bounds.
+   */
+    inline void clearBounds(void) { _bounded = false; };
 #endif
 
   private:
+    template <uint8_t N> friend class MD_REncoderBank;
+    template <uint8_t PIN_A, uint8_t PIN_B, uint8_t MODE, uint16_t PERIOD> friend class MD_REncoderT;
+
+    typedef uint8_t ttable_t[4];    // one row of a state table
+#if ENABLE_COMPACT
+    typedef uint16_t  stamp_t;  // millis() time stamp, low 16 bits only
+#else
+    typedef uint32_t  stamp_t;  // millis() time stamp
+#endif
+
+#if RE_FAST_IO
+#if defined(__AVR__)
+    typedef uint8_t   portReg_t;  // native width of a port input register
+#else
+    typedef uint32_t  portReg_t;
+#endif
+#endif
+
     // Hardware data
     uint8_t _pinA;      // pin A number
     uint8_t _pinB;      // pin B number
+
+#if RE_PORT_INDEX
+    uint8_t _portA;     // port for pin A, NOT_A_PORT if digitalRead() is used
+    uint8_t _portB;     // port for pin B
+#elif RE_FAST_IO
+    volatile portReg_t *_regA;  // input register for pin A, NULL if digitalRead() is used
+    volatile portReg_t *_regB;  // input register for pin B
+#endif
+#if RE_FAST_IO
+    portReg_t _maskA;   // bit mask for pin A in its register
+    portReg_t _maskB;   // bit mask for pin B in its register
+#endif
     
     // Encoder value
+#if ENABLE_COMPACT
+    uint8_t _state;     // latest state for the encoder, with the step mode in the top 2 bits
+#else
+    const ttable_t *_ttable;  // state table for the step mode (in PROGMEM)
     uint8_t _state;     // latest state for the encoder
+#endif
+    uint8_t _pins;      // last pin sample and change flag
 
 #if ENABLE_SPEED    
     // Velocity data
+#if ENABLE_WIDE_SPEED
+    typedef uint32_t  count_t;  // count of clicks in a period
+#else
+    typedef uint16_t  count_t;
+#endif
+#if ENABLE_COMPACT
+    typedef int8_t    net_t;    // net count of clicks in a period, only used for the sign
+#elif ENABLE_WIDE_SPEED
+    typedef int32_t   net_t;
+#else
+    typedef int16_t   net_t;
+#endif
     uint16_t  _period;  // velocity calculation period
-    uint16_t  _count;   // running count of encoder clicks
-    uint16_t  _spd;     // last calculated speed (no sign) in clicks/second
-    uint32_t  _timeLast;  // last time read
+    count_t   _count;   // running count of encoder clicks
+    speed_t   _spd;     // last calculated speed (no sign) in clicks/second
+    net_t     _net;     // running net count of encoder clicks (CW - CCW)
+    net_t     _netLast; // net count of clicks in the last period
+#if !ENABLE_COMPACT
+    uint16_t  _span;    // actual length of the last period
+#endif
+    stamp_t   _timeLast;  // start time of the current period
+
+    void countSpeed(uint8_t e, uint32_t now); // count event e at time now
+    void endPeriod(uint32_t now);  // calculate the speed for the period ending now
+    speed_t speedWindow(void);     // speed from the click count
+#endif
+
+#if ENABLE_SPEED && ENABLE_SPEED_SMOOTH
+    // Speed smoothing data
+    uint8_t   _smooth;      // smoothing filter, one of smooth_t
+    uint8_t   _smoothParam; // alpha for SMOOTH_EMA, number of periods for SMOOTH_AVERAGE
+    uint32_t  _ema;         // SMOOTH_EMA speed in Q4 fixed point
+    speed_t   _hist[SPEED_HISTORY]; // SMOOTH_AVERAGE speed for recent periods
+    uint32_t  _histSum;     // sum of the speeds in _hist
+    uint8_t   _histIdx;     // next entry in _hist
+
+    speed_t smoothSpeed(speed_t spd, uint32_t periods);  // apply the filter to a new period
+#endif
+
+#if ENABLE_SPEED && ENABLE_SPEED_INTERVAL
+    // Step interval speed data
+    speedMode_t _speedMode; // method used by speed()
+    uint16_t  _stall;       // stall timeout in milliseconds
+    uint8_t   _stepDir;     // direction of the last step
+    volatile uint32_t _stepTime;  // micros() time of the last step
+    volatile uint32_t _interval;  // average time between steps in microseconds, 0 if unknown
+
+    uint32_t stepInterval(uint8_t &dir);  // effective step interval and direction
+    speed_t speedInterval(void);  // speed from the step interval
+#endif
+
+#if ENABLE_POSITION
+    // Position data
+    volatile int32_t _pos;  // current position
+    int32_t   _posRead;     // position at the last readDelta()
 #endif
+
+#if ENABLE_ACCEL
+    // Acceleration data
+    const accelPoint_t *_curve; // acceleration curve, NULL if none
+    uint8_t   _curvePoints;     // number of points in _curve
+    bool      _bounded;         // true if the position is bounded
+    int32_t   _posMin;          // lowest position if bounded
+    int32_t   _posMax;          // highest position if bounded
+
+    uint16_t accelMult(void);   // position change for the current speed
+#endif
+
+#if ENABLE_FILTER
+    // Glitch filter data
+    uint8_t   _filterCount; // required number of identical samples
+    uint16_t  _filterTime;  // required dwell time in microseconds
+    uint8_t   _cand;        // candidate new pin state
+    uint8_t   _candCount;   // samples of the candidate seen, 0 if none
+    uint32_t  _candTime;    // time the candidate was first seen
+#endif
+
+#if ENABLE_STATS
+    stats_t   _stats;     // decoder statistics
+#endif
+
+#if ENABLE_TIMING
+    // Step timing data
+    timing_t  _timing;    // timing data, intervalMean is calculated by getTiming()
+    uint32_t  _tmSum;     // sum of the step intervals for the mean
+    uint16_t  _tmCount;   // number of step intervals in _tmSum
+    bool      _tmStepped; // true once a step has been timed (decoding context)
+    bool      _tmPolled;  // true once read() has been timed (read() context)
+    uint32_t  _tmPoll;    // micros() time of the last read()
+
+    void timeStep(void);  // time a step, in the decoding context
+    void timePoll(void);  // time a call to read()
+    void timeLatency(uint32_t t); // time reading a step decoded at t
+#endif
+
+#if ENABLE_OVERRUN
+    // Missed edge data
+    bool      _recover;     // true if recovering missed edges
+    uint8_t   _moveDir;     // direction of the last valid transition, DIR_NONE if stopped
+    uint32_t  _moveTime;    // micros() time of the last valid transition
+    uint8_t   _pending;     // second event from a recovered overrun
+    uint32_t  _overruns;    // number of overruns seen
+
+    uint8_t overrun(uint8_t last, uint8_t pinstate);  // handle a skipped state
+#endif
+
+#if ENABLE_SWITCH
+    // Push switch data
+    static const uint8_t SW_PRESSED = 0x01;   // debounced switch is pressed
+    static const uint8_t SW_CHANGING = 0x02;  // raw switch differs from the debounced state
+    static const uint8_t SW_TURNED = 0x04;    // encoder turned during this press
+    static const uint8_t SW_LONG = 0x08;      // long press reported for this press
+    static const uint8_t SW_FRESH = 0x10;     // _swRaw was sampled with A and B by this read()
+
+    uint8_t   _pinS;        // switch pin number, SW_NONE if none
+#if RE_FAST_IO
+    volatile portReg_t *_regS;  // input register for the switch, NULL if digitalRead() is used
+    portReg_t _maskS;       // bit mask for the switch in its register
+#endif
+    uint8_t   _swActive;    // pin level when pressed
+    uint8_t   _swRaw;       // last raw switch level
+    uint8_t   _swFlags;     // switch state flags
+    uint8_t   _swDebounce;  // debounce time in ms
+    uint16_t  _swLong;      // long press time in ms
+    uint16_t  _swChange;    // millis() when the raw level changed, low 16 bits
+    uint16_t  _swPress;     // millis() when the press was accepted, low 16 bits
+    cbEvent_t _callback;    // event callback, NULL if none
+
+    uint8_t readSwitch(void); // return the switch pin level
+    void switchEvent(uint8_t e, uint32_t now);  // update the switch and dispatch the events
+#endif
+
+#if ENABLE_INDEX
+    // Index channel data
+    static const uint8_t IDX_LEVEL = 0x01;  // index pin was active at the last check
+    static const uint8_t IDX_SEEN = 0x02;   // _zRef is set from an index crossing
+    static const uint8_t IDX_HOME = 0x04;   // zero the position at the next crossing
+    static const uint8_t IDX_HOMED = 0x08;  // position was zeroed at a crossing
+    static const uint8_t IDX_CW = 0x10;     // last crossing was clockwise
+
+    uint8_t   _pinZ;        // index pin number, INDEX_NONE if none
+#if RE_FAST_IO
+    volatile portReg_t *_regZ;  // input register for the index, NULL if digitalRead() is used
+    portReg_t _maskZ;       // bit mask for the index in its register
+#endif
+    uint8_t   _zActive;     // pin level during the index pulse
+    volatile uint8_t _zFlags; // index state flags
+    uint8_t   _zRaw;        // raw index level read with A and B
+    uint16_t  _cpr;         // edges per revolution, 0 for no check
+    int32_t   _zCount;      // edges counted since begin
+    int32_t   _zRef;        // _zCount at the last crossing
+    volatile int32_t _zPos; // position at the last crossing
+    volatile int32_t _revs; // revolution count
+    volatile uint16_t _zErrors; // number of revolutions in error
+    volatile int16_t _zDrift;   // error in steps for the last revolution in error
+
+    void indexCheck(uint8_t last, uint8_t pinstate);  // count the edge and check for an index crossing
+#endif
+
+#if RE_HW_COUNTER
+    // Hardware counter data
+    int8_t  _hwUnit;    // hardware counter unit, -1 if not used
+    volatile int32_t _hwOver; // count from the counter limit events (legacy driver)
+    int32_t _hwTotal;   // extended hardware count at the last hwUpdate()
+    int32_t _hwUsed;    // hardware count already returned as events
+#if ENABLE_POSITION
+    int32_t _hwPos;     // hardware count already added to the position
+#endif
+
+    static uint8_t _hwNext; // next hardware unit to allocate
+
+    bool hwBegin(void);     // set up the hardware counter
+    void hwUpdate(void);    // read the hardware count and update the position
+    int32_t hwCount(void);  // read the extended hardware count
+    static void RE_ISR_ATTR hwLimit(void *arg); // counter limit event handler
+    uint8_t hwEvent(void);  // next event from the hardware count
+    uint8_t hwDivisor(void);  // hardware counts per event for the step mode
+#endif
+
+#if ENABLE_INTERRUPT
+    // Interrupt mode data
+    bool _isr;          // true if running in interrupt mode
+    volatile uint8_t _qHead;    // queue index written by isr()
+    volatile uint8_t _qTail;    // queue index written by read()
+    uint8_t _queue[EVENT_QUEUE_SIZE]; // queued events
+#if ENABLE_EVENT_TIME || ENABLE_TIMING
+    uint32_t _qTime[EVENT_QUEUE_SIZE];  // micros() time of the queued events
+#endif
+
+    static MD_REncoder *_isrObj[MAX_ISR_ENCODERS]; // objects served by the built-in handlers
+
+    bool attachISR(void);   // attach the built-in interrupt handlers
+    void push(uint8_t e);   // add an event to the queue
+    void RE_ISR_ATTR isrSample(uint8_t pinstate); // process pinstate and queue the events
+    static void RE_ISR_ATTR isr0(void);
+    static void RE_ISR_ATTR isr1(void);
+    static void RE_ISR_ATTR isr2(void);
+    static void RE_ISR_ATTR isr3(void);
+#endif
+
+#if ENABLE_TIMER
+    // Timer tick sampler data
+    static MD_REncoder *_tickObj[MAX_TIMER_ENCODERS]; // encoders sampled by tick()
+    static volatile uint8_t _tickCount; // number of entries in _tickObj[]
+#endif
+
+#if ENABLE_PCINT
+    // Pin change interrupt dispatcher data
+    static MD_REncoder *_pcObj[MAX_PCINT_ENCODERS]; // encoders using pin change interrupts
+    static uint8_t _pcCount;  // number of entries in _pcObj[]
+#if RE_PCINT_GROUPS && RE_FAST_IO
+    static volatile portReg_t *_pcPort[RE_PCINT_GROUPS];  // input register for each group
+    static portReg_t _pcLast[RE_PCINT_GROUPS];  // last reading of each port
+    static portReg_t _pcMask[RE_PCINT_GROUPS];  // bits used by encoders in each port
+    static uint8_t _pcMap[RE_PCINT_GROUPS][8];  // _pcObj[] index + 1 for each bit, 0 if none
+#endif
+
+    bool attachPCINT(void); // attach to the pin change interrupt dispatcher
+#endif
+
+#if ENABLE_TASK
+    // Decode task data
+    snapshot_t _snap;   // data published by service()
+    volatile uint32_t _seq; // snapshot sequence number, odd while it is updated
+
+    static MD_REncoder *_taskObj[MAX_TASK_ENCODERS]; // encoders read by service()
+    static volatile uint8_t _taskCount; // number of entries in _taskObj[]
+
+    void publish(void);     // read the pending events and update the snapshot
+#endif
+
+#if ENABLE_ADAPTIVE
+    // Adaptive poll interval data
+    volatile bool _adActive;  // A or B changed since the last pollInterval()
+    uint16_t  _adMin;       // shortest interval in microseconds
+    uint32_t  _adMax;       // longest interval in microseconds
+    uint32_t  _adInterval;  // current interval in microseconds
+#if ENABLE_TIMER
+    static uint16_t _adRate; // sample rate set by adaptSampler()
+#endif
+#endif
+
+    static const ttable_t _ttFull[];  // full-step state table (in PROGMEM)
+    static const ttable_t _ttHalf[];  // half-step state table (in PROGMEM)
+    static const ttable_t _ttQuarter[]; // quarter-step state table (in PROGMEM)
+    static const ttable_t *getTable(stepMode_t mode); // state table for mode
+#if ENABLE_COMPACT
+    inline const ttable_t *table(void) { return(getTable((stepMode_t)(_state >> 6))); };
+#else
+    inline const ttable_t *table(void) { return(_ttable); };
+#endif
+#if RE_PORT_INDEX
+    inline volatile portReg_t *regA(void) { return(_portA == NOT_A_PORT ? NULL : (volatile portReg_t *)portInputRegister(_portA)); };
+    inline volatile portReg_t *regB(void) { return(_portB == NOT_A_PORT ? NULL : (volatile portReg_t *)portInputRegister(_portB)); };
+#elif RE_FAST_IO
+    inline volatile portReg_t *regA(void) { return(_regA); };
+    inline volatile portReg_t *regB(void) { return(_regB); };
+#endif
+
+    uint8_t readPins(void); // return the current pin state as (B << 1) | A
+    uint8_t process(uint8_t pinstate);  // run the state table for pinstate, return event
+    uint8_t sample(uint8_t pinstate); // process pinstate if changed
+    uint8_t nextEvent(void);  // decode the pins or take an event from the queue
+    void step(uint8_t e);   // account for the step event e
 };
 
 #endif
@@ -0,0 +1,224 @@
+/*
+MD_REncoderBank - Multiple Rotary Encoders for the MD_REncoder library
+
+See MD_REncoder.h for comments and copyright notice.
+*/
+#ifndef _MD_RENCODERBANK_H
+#define _MD_RENCODERBANK_H
+
+#include <MD_REncoder.h>
+
+/**
+ * \file
+ * \brief Header file for the MD_REncoderBank class template
+ */
+
+/**
+ * Bank of N encoders decoded together.
+ *
+ * Each GPIO port used by the encoders is read only once per call to read(),
+ * and the state table transitions for all the encoders are run in one loop. This
+ * scales much better than one MD_REncoder object per encoder when there are many of
+ * them. The speed calculation is not available for a bank.
+ *
+ * \tparam N the number of encoders in the bank (1 to 32).
+ */
+template <uint8_t N>
+class MD_REncoderBank
+{
+  public:
+  /**
+   * Class Constructor.
+   *
+   * Instantiate a new instance of the class. The pin numbers are copied
+   * from the arrays, which therefore do not need to persist.
+   *
+   * \param pinA  array of N pin numbers for the encoder A outputs
+   * \param pinB  array of N pin numbers for the encoder B outputs
+   * \param mode  the step mode for all the encoders, defaults to the ENABLE_HALF_STEP setting
+   */
+    MD_REncoderBank(const uint8_t pinA[N], const uint8_t pinB[N], 
+      MD_REncoder::stepMode_t mode = (ENABLE_HALF_STEP ? MD_REncoder::STEP_HALF : MD_REncoder::STEP_FULL)):
+    _ttable(MD_REncoder::getTable(mode))
+    {
+      for (uint8_t i = 0; i < N; i++)
+      {
+        _pinA[i] = pinA[i];
+        _pinB[i] = pinB[i];
+        _state[i] = 0;
+      }
+      _pending = 0;
+#if RE_FAST_IO
+      _numPorts = 0;
+#endif
+    };
+
+  /**
+   * Initialize the object.
+   *
+   * Set up the pins and work out the ports that need to be read. This
+   * should be called once before read() is used.
+   */
+    void begin(void)
+    {
+      for (uint8_t i = 0; i < N; i++)
+      {
+        pinMode(_pinA[i], (ENABLE_PULLUPS ? INPUT_PULLUP : INPUT));
+        pinMode(_pinB[i], (ENABLE_PULLUPS ? INPUT_PULLUP : INPUT));
+      }
+
+#if RE_FAST_IO
+      // Build the list of distinct port registers and the register
+      // index and mask for each pin. If any pin does not map to a
+      // port then digitalRead() is used for all of them.
+      _numPorts = 0;
+      for (uint8_t i = 0; i < N; i++)
+      {
+        if (!mapPin(_pinA[i], _portA[i], _maskA[i]) ||
+            !mapPin(_pinB[i], _portB[i], _maskB[i]))
+        {
+          _numPorts = 0;
+          break;
+        }
+      }
+#endif
+
+      // Prime the states from the current pins. No table emits an 
+      // event from the start state.
+      for (uint8_t i = 0; i < N; i++)
+        _state[i] = 0;
+      read();
+      _pending = 0;
+    };
+
+  /**
+   * Read the direction of rotation for all the encoders.
+   *
+   * Sample all the encoder inputs and run the state table for each encoder.
+   * This method should be called on a frequent regular basis to ensure smooth
+   * encoder inputs.
+   *
+   * \return A bit mask with bit i set if encoder i generated an event. Use
+   * event() to get the direction for that encoder.
+   */
+    uint32_t read(void)
+    {
+      uint32_t mask = 0;
+
+#if RE_FAST_IO
+      if (_numPorts != 0)
+      {
+        MD_REncoder::portReg_t sample[2 * N];
+
+        for (uint8_t p = 0; p < _numPorts; p++)
+          sample[p] = *_port[p];
+
+        for (uint8_t i = 0; i < N; i++)
+        {
+          uint8_t pinstate = ((sample[_portB[i]] & _maskB[i]) ? 2 : 0) | ((sample[_portA[i]] & _maskA[i]) ? 1 : 0);
+
+          _state[i] = pgm_read_byte(&_ttable[_state[i] & 0xf][pinstate]);
+          if (_state[i] & 0x30) mask |= (1UL << i);
+        }
+
+        return(mask);
+      }
+#endif
+
+      for (uint8_t i = 0; i < N; i++)
+      {
+        uint8_t pinstate = (digitalRead(_pinB[i]) << 1) | digitalRead(_pinA[i]);
+
+        _state[i] = pgm_read_byte(&_ttable[_state[i] & 0xf][pinstate]);
+        if (_state[i] & 0x30) mask |= (1UL << i);
+      }
+
+      return(mask);
+    };
+
+  /**
+   * Return the last event for an encoder.
+   *
+   * Return the event generated by encoder i during the last call to read().
+   *
+   * \param i the encoder index, 0 to N-1.
+   * \return One of the DIR_NONE, DIR_CW or DIR_CCW.
+   */
+    inline uint8_t event(uint8_t i) { return(i < N ? (_state[i] & 0x30) : DIR_NONE); };
+
+  /**
+   * Read the events for all the encoders.
+   *
+   * Copy the events from a call to read() into buf, with the encoder index as 
+   * the id. If there are more than max events, the rest are returned by the next 
+   * call before the encoders are read again.
+   *
+   * \param buf the array to receive the events.
+   * \param max the number of entries in buf.
+   * \return The number of events copied to buf.
+   */
+    uint8_t readEvents(MD_REncoder::eventRec_t *buf, uint8_t max)
+    {
+      uint8_t n = 0;
+#if ENABLE_EVENT_TIME
+      uint32_t now = micros();
+#endif
+
+      if (_pending == 0)
+        _pending = read();
+
+      for (uint8_t i = 0; _pending != 0 && n < max; i++)
+      {
+        if (_pending & (1UL << i))
+        {
+          _pending &= ~(1UL << i);
+          buf[n].id = i;
+          buf[n].dir = _state[i] & 0x30;
+#if ENABLE_EVENT_TIME
+          buf[n].time = now;
+#endif
+          n++;
+        }
+      }
+
+      return(n);
+    };
+
+  private:
+    static_assert(N > 0 && N <= 32, "MD_REncoderBank supports 1 to 32 encoders");
+
+    uint8_t _pinA[N];   // pin A numbers
+    uint8_t _pinB[N];   // pin B numbers
+    const MD_REncoder::ttable_t *_ttable; // state table for the step mode (in PROGMEM)
+    uint8_t _state[N];  // latest state for each encoder
+    uint32_t _pending;  // events from the last read() not yet returned by readEvents()
+
+#if RE_FAST_IO
+    uint8_t _numPorts;  // number of entries in _port[], 0 if digitalRead() is used
+    volatile MD_REncoder::portReg_t *_port[2 * N];  // distinct input registers to sample
+    uint8_t _portA[N];  // index into _port[] for each pin A
+    uint8_t _portB[N];  // index into _port[] for each pin B
+    MD_REncoder::portReg_t _maskA[N];  // bit mask for each pin A
+    MD_REncoder::portReg_t _maskB[N];  // bit mask for each pin B
+
+    bool mapPin(uint8_t pin, uint8_t &idx, MD_REncoder::portReg_t &mask)
+    // Find or add the input register for pin in _port[].
+    // Return false if the pin does not map to a port.
+    {
+      volatile MD_REncoder::portReg_t *reg = (volatile MD_REncoder::portReg_t *)portInputRegister(digitalPinToPort(pin));
+
+      if (reg == NULL)
+        return(false);
+
+      mask = digitalPinToBitMask(pin);
+      for (idx = 0; idx < _numPorts; idx++)
+        if (_port[idx] == reg)
+          return(true);
+
+      _port[_numPorts++] = reg;
+      return(true);
+    };
+#endif
+};
+
+#endif
@@ -0,0 +1,185 @@
+/*
+MD_REncoderSaver - Wear levelled EEPROM saver for the MD_REncoder library
+
+See MD_REncoder.h for comments and copyright notice.
+*/
+#ifndef _MD_RENCODERSAVER_H
+#define _MD_RENCODERSAVER_H
+
+#include <MD_REncoder.h>
+#include <EEPROM.h>
+
+/**
+ * \file
+ * \brief Header file for the MD_REncoderSaver class
+ */
+
+#if !ENABLE_PERSIST
+#error "MD_REncoderSaver needs ENABLE_PERSIST set to 1 in MD_REncoder.h"
+#endif
+
+/**
+ \def DEFAULT_SAVE_IDLE
+ Default time in milliseconds the state must be unchanged before it is saved.
+ */
+#define DEFAULT_SAVE_IDLE 2000
+
+/**
+ * Save the state of an encoder to EEPROM.
+ *
+ * The state from MD_REncoder::serialize() is written to a ring of slots in
+ * EEPROM, each with a sequence number, to spread the wear. A slot is only
+ * written once the state has changed and then been left unchanged for the
+ * idle time, and only the bytes that are different are written.
+ */
+class MD_REncoderSaver
+{
+  public:
+  /**
+   * Size of one slot in EEPROM.
+   */
+    static const uint8_t SLOT_SIZE = PERSIST_SIZE + 1;
+
+  /**
+   * Class Constructor.
+   *
+   * Instantiate a new instance of the class. The EEPROM used is slots
+   * * SLOT_SIZE bytes from address base.
+   *
+   * \param re    the encoder to save.
+   * \param base  the EEPROM address of the first slot.
+   * \param slots the number of slots (1 to 127).
+   * \param idle  the time in ms the state must be unchanged before it is saved.
+   */
+    MD_REncoderSaver(MD_REncoder &re, uint16_t base, uint8_t slots, uint16_t idle = DEFAULT_SAVE_IDLE):
+    _re(re), _base(base), _slots(slots), _idle(idle), _slot(0), _seq(0), _changed(0), _dirty(false)
+    {
+      memset(_saved, 0, sizeof(_saved));
+      memset(_last, 0, sizeof(_last));
+    };
+
+  /**
+   * Initialize the object.
+   *
+   * Find the newest valid slot and restore the encoder from it. The
+   * other slots are only checked, so the encoder is changed once. This
+   * should be called after the encoder begin().
+   *
+   * \return true if the encoder state was restored.
+   */
+    bool begin(void)
+    {
+      int16_t newest = -1;
+      uint8_t buf[PERSIST_SIZE];
+
+      for (uint8_t i = 0; i < _slots; i++)
+      {
+        uint8_t seq = EEPROM.read(addr(i));
+
+        readSlot(i, buf);
+        if (!MD_REncoder::isValid(buf, PERSIST_SIZE))
+          continue;
+
+        // sequence numbers wrap, so compare the difference
+        if (newest < 0 || (int8_t)(seq - _seq) > 0)
+        {
+          newest = i;
+          _seq = seq;
+        }
+      }
+
+      if (newest >= 0)
+      {
+        _slot = newest;
+        readSlot(_slot, buf);
+        _re.restore(buf, PERSIST_SIZE);
+      }
+
+      _re.serialize(_saved, PERSIST_SIZE);
+      memcpy(_last, _saved, PERSIST_SIZE);
+      _dirty = false;
+
+      return(newest >= 0);
+    };
+
+  /**
+   * Save the state if it needs it.
+   *
+   * Check the encoder state and save it if it has changed and then been
+   * unchanged for the idle time. This should be called regularly from loop().
+   *
+   * \return true if the state was written to EEPROM.
+   */
+    bool update(void)
+    {
+      uint8_t buf[PERSIST_SIZE];
+      uint16_t now = millis();
+
+      _re.serialize(buf, PERSIST_SIZE);
+      if (memcmp(buf, _last, PERSIST_SIZE) != 0)
+      {
+        memcpy(_last, buf, PERSIST_SIZE);
+        _changed = now;
+        _dirty = (memcmp(buf, _saved, PERSIST_SIZE) != 0);
+        return(false);
+      }
+
+      if (!_dirty || (uint16_t)(now - _changed) < _idle)
+        return(false);
+
+      save();
+      return(true);
+    };
+
+  /**
+   * Save the state now.
+   *
+   * Write the encoder state to the next slot whether or not it has changed
+   * and without waiting for the idle time.
+   */
+    void save(void)
+    {
+      _re.serialize(_saved, PERSIST_SIZE);
+      memcpy(_last, _saved, PERSIST_SIZE);
+      _dirty = false;
+
+      _slot = (_slot + 1) % _slots;
+      _seq++;
+      writeByte(addr(_slot), _seq);
+      for (uint8_t i = 0; i < PERSIST_SIZE; i++)
+        writeByte(addr(_slot) + 1 + i, _saved[i]);
+#if defined(ESP32) || defined(ESP8266) || defined(ARDUINO_ARCH_RP2040)
+      EEPROM.commit();
+#endif
+    };
+
+  private:
+    MD_REncoder &_re;   // encoder being saved
+    uint16_t _base;     // EEPROM address of slot 0
+    uint8_t  _slots;    // number of slots
+    uint16_t _idle;     // time the state must be unchanged before it is saved
+    uint8_t  _slot;     // slot last written
+    uint8_t  _seq;      // sequence number of the slot last written
+    uint16_t _changed;  // millis() when the state last changed, low 16 bits
+    bool     _dirty;    // state is different from the saved state
+    uint8_t  _saved[PERSIST_SIZE];  // state last saved
+    uint8_t  _last[PERSIST_SIZE];   // state at the last update()
+
+    inline uint16_t addr(uint8_t slot) { return(_base + (uint16_t)slot * SLOT_SIZE); };
+
+    void readSlot(uint8_t slot, uint8_t *buf)
+    // Read the state from a slot, after the sequence number
+    {
+      for (uint8_t i = 0; i < PERSIST_SIZE; i++)
+        buf[i] = EEPROM.read(addr(slot) + 1 + i);
+    };
+
+    void writeByte(uint16_t a, uint8_t v)
+    // Only write the byte if it is different, to save wear
+    {
+      if (EEPROM.read(a) != v)
+        EEPROM.write(a, v);
+    };
+};
+
+#endif
@@ -0,0 +1,243 @@
+/*
+MD_REncoderT - Compile time Rotary Encoder for the MD_REncoder library
+
+See MD_REncoder.h for comments and copyright notice.
+*/
+#ifndef _MD_RENCODERT_H
+#define _MD_RENCODERT_H
+
+#include <MD_REncoder.h>
+
+/**
+ * \file
+ * \brief Header file for the MD_REncoderT class template
+ */
+
+// On these AVR devices the Arduino pin to port mapping is fixed, so the 
+// port bit for a constant pin number is also a compile time constant.
+// The direct port reads are only used when ENABLE_FAST_IO is set.
+#if ENABLE_FAST_IO && (defined(__AVR_ATmega328P__) || defined(__AVR_ATmega328__) || defined(__AVR_ATmega168__) || defined(__AVR_ATmega88__) || defined(__AVR_ATmega48__))
+#define RE_CONST_PORTS  1
+#else
+#define RE_CONST_PORTS  0
+#endif
+
+/**
+ * Speed data for MD_REncoderT when PERIOD is not 0.
+ *
+ * The speed is calculated in the same way as the MD_REncoder windowed speed, 
+ * counting the steps in each PERIOD ms.
+ */
+template <uint16_t PERIOD>
+class MD_REncoderTSpeed
+{
+  public:
+    MD_REncoderTSpeed(void): _count(0), _spd(0), _timeLast(0) {};
+
+  /**
+   * Return the speed of the encoder.
+   *
+   * \return The speed in clicks per second.
+   */
+    uint16_t speed(void)
+    {
+      uint32_t now = millis();
+
+      if (now - _timeLast >= PERIOD)
+        endPeriod(now);
+
+      return(_spd);
+    };
+
+  protected:
+    inline void countSpeed(uint8_t e)
+    // Count the event e in the current sampling period. Only a step
+    // needs the time, as speed() closes the period when nothing moves.
+    {
+      if (e == DIR_NONE)
+        return;
+
+      uint32_t now = millis();
+
+      if (now - _timeLast >= PERIOD)
+        endPeriod(now);
+
+      if (_count != 0xffff) _count++;
+    };
+
+  private:
+    uint16_t  _count;     // count of steps in the current period
+    uint16_t  _spd;       // speed for the last complete period
+    uint32_t  _timeLast;  // start time of the current period
+
+    void endPeriod(uint32_t now)
+    // Calculate the speed for the period that has just ended. If more 
+    // than two periods have elapsed there were no steps in the last one.
+    {
+      uint32_t dt = now - _timeLast;
+
+      if (dt >= 2UL * PERIOD)
+        _spd = 0;
+      else
+      {
+        uint32_t spd = ((uint32_t)_count * 1000) / dt;
+
+        _spd = (spd > 0xffff ? 0xffff : spd);
+      }
+
+      _timeLast = now;
+      _count = 0;
+    };
+};
+
+/**
+ * No speed data for MD_REncoderT when PERIOD is 0.
+ */
+template <>
+class MD_REncoderTSpeed<0>
+{
+  protected:
+    inline void countSpeed(uint8_t) {};
+};
+
+/**
+ * Rotary encoder with the pins and step mode fixed at compile time.
+ *
+ * The pin numbers and step mode are template parameters, so no RAM is used 
+ * to store them and the compiler can resolve the pin reads and the state table 
+ * when the code is built. With ENABLE_FAST_IO on the ATmega328P family the pin 
+ * reads compile down to direct port bit reads. On other architectures the port 
+ * registers are looked up by begin() and shared by all objects with the same 
+ * template parameters. Without ENABLE_FAST_IO digitalRead() is used.
+ * The object itself only holds the decoder state, plus the speed data if PERIOD 
+ * is not 0.
+ *
+ * \tparam PIN_A  the pin number for encoder output A.
+ * \tparam PIN_B  the pin number for encoder output B.
+ * \tparam MODE   the step mode (one of MD_REncoder::stepMode_t), defaults to the ENABLE_HALF_STEP setting.
+ * \tparam PERIOD the speed sampling period in ms, or 0 (default) for no speed calculation.
+ */
+template <uint8_t PIN_A, uint8_t PIN_B, 
+  uint8_t MODE = (ENABLE_HALF_STEP ? MD_REncoder::STEP_HALF : MD_REncoder::STEP_FULL), 
+  uint16_t PERIOD = 0>
+class MD_REncoderT : public MD_REncoderTSpeed<PERIOD>
+{
+  public:
+  /**
+   * Class Constructor.
+   *
+   * Instantiate a new instance of the class.
+   */
+    MD_REncoderT(void): _state(0) {};
+
+  /**
+   * Initialize the object.
+   *
+   * Set up the pins and the decoder state. This should be called once 
+   * before read() is used.
+   */
+    void begin(void)
+    {
+      uint8_t pinstate;
+
+      pinMode(PIN_A, (ENABLE_PULLUPS ? INPUT_PULLUP : INPUT));
+      pinMode(PIN_B, (ENABLE_PULLUPS ? INPUT_PULLUP : INPUT));
+
+#if !RE_CONST_PORTS && RE_FAST_IO
+      _regA = (volatile MD_REncoder::portReg_t *)portInputRegister(digitalPinToPort(PIN_A));
+      _regB = (volatile MD_REncoder::portReg_t *)portInputRegister(digitalPinToPort(PIN_B));
+      _maskA = digitalPinToBitMask(PIN_A);
+      _maskB = digitalPinToBitMask(PIN_B);
+      if (_regA == NULL || _regB == NULL)
+        _regA = _regB = NULL;
+#endif
+
+      // Prime the state from the current pins. No table emits an 
+      // event from the start state.
+      pinstate = readPins();
+      _state = (pgm_read_byte(&table()[0][pinstate]) & 0xf) | (pinstate << PINS_SHIFT);
+    };
+
+  /**
+   * Read the direction of rotation.
+   *
+   * Sample the encoder inputs and run the state table. This method should 
+   * be called on a frequent regular basis to ensure smooth encoder inputs.
+   *
+   * \return One of the DIR_NONE, DIR_CW or DIR_CCW.
+   */
+    uint8_t read(void)
+    {
+      uint8_t pinstate = readPins();
+      uint8_t e = DIR_NONE;
+
+      // the state only changes when the pins do
+      if (pinstate != (_state >> PINS_SHIFT))
+      {
+        _state = pgm_read_byte(&table()[_state & 0xf][pinstate]);
+        e = _state & 0x30;
+        _state = (_state & 0xf) | (pinstate << PINS_SHIFT);
+      }
+
+      this->countSpeed(e);
+
+      return(e);
+    };
+
+  private:
+    static_assert(MODE <= MD_REncoder::STEP_QUARTER, "MD_REncoderT MODE must be a MD_REncoder::stepMode_t");
+#if RE_CONST_PORTS
+    static_assert(PIN_A < 20 && PIN_B < 20, "MD_REncoderT pins must be 0 to 19 (A5)");
+#endif
+
+    static const uint8_t PINS_SHIFT = 6;  // last pin sample is kept in the top bits of _state
+
+    uint8_t _state;   // decoder state and last pin sample
+
+    static inline const MD_REncoder::ttable_t *table(void)
+    // state table for MODE (in PROGMEM)
+    {
+      return(MODE == MD_REncoder::STEP_QUARTER ? MD_REncoder::_ttQuarter : 
+        (MODE == MD_REncoder::STEP_HALF ? MD_REncoder::_ttHalf : MD_REncoder::_ttFull));
+    };
+
+#if RE_CONST_PORTS
+    static inline uint8_t readPin(uint8_t pin)
+    // Read a pin using the fixed Arduino pin mapping. When pin is a 
+    // constant this is a single port bit read.
+    {
+      return(pin < 8 ? ((PIND >> pin) & 1) : (pin < 14 ? ((PINB >> (pin - 8)) & 1) : ((PINC >> (pin - 14)) & 1)));
+    };
+
+    static inline uint8_t readPins(void) { return((readPin(PIN_B) << 1) | readPin(PIN_A)); };
+#else
+#if RE_FAST_IO
+    static volatile MD_REncoder::portReg_t *_regA;  // input register for pin A, NULL if digitalRead() is used
+    static volatile MD_REncoder::portReg_t *_regB;  // input register for pin B
+    static MD_REncoder::portReg_t _maskA;  // bit mask for pin A
+    static MD_REncoder::portReg_t _maskB;  // bit mask for pin B
+#endif
+
+    static inline uint8_t readPins(void)
+    {
+#if RE_FAST_IO
+      if (_regA != NULL)
+        return(((*_regB & _maskB) ? 2 : 0) | ((*_regA & _maskA) ? 1 : 0));
+#endif
+      return((digitalRead(PIN_B) << 1) | digitalRead(PIN_A));
+    };
+#endif
+};
+
+#if !RE_CONST_PORTS && RE_FAST_IO
+template <uint8_t PIN_A, uint8_t PIN_B, uint8_t MODE, uint16_t PERIOD>
+volatile MD_REncoder::portReg_t *MD_REncoderT<PIN_A, PIN_B, MODE, PERIOD>::_regA = NULL;
+template <uint8_t PIN_A, uint8_t PIN_B, uint8_t MODE, uint16_t PERIOD>
+volatile MD_REncoder::portReg_t *MD_REncoderT<PIN_A, PIN_B, MODE, PERIOD>::_regB = NULL;
+template <uint8_t PIN_A, uint8_t PIN_B, uint8_t MODE, uint16_t PERIOD>
+MD_REncoder::portReg_t MD_REncoderT<PIN_A, PIN_B, MODE, PERIOD>::_maskA = 0;
+template <uint8_t PIN_A, uint8_t PIN_B, uint8_t MODE, uint16_t PERIOD>
+MD_REncoder::portReg_t MD_REncoderT<PIN_A, PIN_B, MODE, PERIOD>::_maskB = 0;
+#endif
+
+#endif
@@ -0,0 +1,357 @@
+/*
+MD_REncoder - Library for Rotary Encoders
+
+See header file for comments
+
+This version copyright (C) 2014 Marco Colli. All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/**
+ * \file
+ * \brief Implements the hardware quadrature counter backends
+ */
+#include <MD_REncoder.h>
+
+#if RE_HW_COUNTER
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include "esp_idf_version.h"
+
+// The hardware count is shared by read() in a decode task, the 
+// application and the limit interrupt, which may be on other cores
+static portMUX_TYPE hwMux = portMUX_INITIALIZER_UNLOCKED;
+
+#define HW_LOCK_BEGIN portENTER_CRITICAL_SAFE(&hwMux)
+#define HW_LOCK_END   portEXIT_CRITICAL_SAFE(&hwMux)
+#endif
+
+uint8_t MD_REncoder::_hwNext = 0;
+
+uint8_t MD_REncoder::hwDivisor(void)
+// The hardware counts every edge (4 per full step)
+{
+  switch (getStepMode())
+  {
+    case STEP_HALF:    return(2);
+    case STEP_QUARTER: return(1);
+    default:           return(4);
+  }
+}
+
+void MD_REncoder::hwUpdate(void)
+// Read the hardware count and add all the whole steps not yet counted 
+// to the position at once, so the position does not depend on how 
+// often read() is called to take the events. This is all done in one 
+// lock so that steps are not counted twice when called from two tasks.
+{
+#if ENABLE_POSITION
+  uint8_t div = hwDivisor();
+  int32_t steps;
+#endif
+
+  HW_LOCK_BEGIN;
+  _hwTotal = hwCount();
+
+#if ENABLE_POSITION
+  steps = (_hwTotal - _hwPos) / div;
+  if (steps != 0)
+  {
+    _hwPos += steps * div;
+
+#if ENABLE_ACCEL
+    // Move by the accelerated amount and keep within the bounds
+    int32_t pos = _pos + steps * (int32_t)accelMult();
+
+    if (_bounded)
+    {
+      if (pos < _posMin) pos = _posMin;
+      else if (pos > _posMax) pos = _posMax;
+    }
+    _pos = pos;
+#else
+    _pos += steps;
+#endif
+  }
+#endif
+  HW_LOCK_END;
+}
+
+uint8_t MD_REncoder::hwEvent(void)
+// Return one event for each whole step of hardware counts not
+// yet returned, accounting for it in the same way as a decoded step
+// except for the position, which hwUpdate() has already moved.
+{
+  uint8_t div = hwDivisor();
+  uint8_t e = DIR_NONE;
+  int32_t d;
+
+  hwUpdate();
+  HW_LOCK_BEGIN;
+  d = _hwTotal - _hwUsed;
+
+  if (d >= div)
+  {
+    _hwUsed += div;
+    e = DIR_CW;
+  }
+  else if (d <= -div)
+  {
+    _hwUsed -= div;
+    e = DIR_CCW;
+  }
+  HW_LOCK_END;
+
+  if (e != DIR_NONE) step(e);
+
+  return(e);
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+// ESP32 family pulse counter (PCNT) implementation.
+//
+// Channel 0 counts edges on A with B as the control input, channel 1
+// counts edges on B with A as the control input, so that all 4 edges
+// of a step are counted and the count is positive for DIR_CW. The
+// counter resets to 0 at the limits and the count is extended from
+// the limit events, so it does not matter how long it is between reads.
+//
+// With ESP-IDF 5 and later the pulse_cnt driver accumulates the count
+// over the limit events itself. Earlier versions use the legacy pcnt
+// driver, with the limit interrupt handled here.
+#define HW_LIMIT      32767   // counter limit
+#define HW_FILTER     100     // glitch filter in APB clock cycles (80MHz)
+#define HW_FILTER_NS  1250    // the same glitch filter in ns
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+#include "driver/pulse_cnt.h"
+
+#define HW_UNITS      8       // most units the driver can allocate
+
+static pcnt_unit_handle_t hwHandle[HW_UNITS];  // driver handle for each unit used
+
+bool MD_REncoder::hwBegin(void)
+{
+  pcnt_unit_config_t ucfg;
+  pcnt_glitch_filter_config_t fcfg;
+  pcnt_chan_config_t ccfg;
+  pcnt_unit_handle_t unit = NULL;
+  pcnt_channel_handle_t chA = NULL, chB = NULL;
+
+  if (_hwNext >= HW_UNITS)
+    return(false);
+
+  memset(&ucfg, 0, sizeof(ucfg));
+  ucfg.low_limit = -HW_LIMIT;
+  ucfg.high_limit = HW_LIMIT;
+  ucfg.flags.accum_count = 1;
+  if (pcnt_new_unit(&ucfg, &unit) != ESP_OK)
+    return(false);
+
+  memset(&fcfg, 0, sizeof(fcfg));
+  fcfg.max_glitch_ns = HW_FILTER_NS;
+  pcnt_unit_set_glitch_filter(unit, &fcfg);
+
+  memset(&ccfg, 0, sizeof(ccfg));
+  ccfg.edge_gpio_num = _pinA;
+  ccfg.level_gpio_num = _pinB;
+  if (pcnt_new_channel(unit, &ccfg, &chA) != ESP_OK)
+  {
+    pcnt_del_unit(unit);
+    return(false);
+  }
+  pcnt_channel_set_edge_action(chA, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_DECREASE);
+  pcnt_channel_set_level_action(chA, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE);
+
+  ccfg.edge_gpio_num = _pinB;
+  ccfg.level_gpio_num = _pinA;
+  if (pcnt_new_channel(unit, &ccfg, &chB) != ESP_OK)
+  {
+    pcnt_del_channel(chA);
+    pcnt_del_unit(unit);
+    return(false);
+  }
+  pcnt_channel_set_edge_action(chB, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_DECREASE);
+  pcnt_channel_set_level_action(chB, PCNT_CHANNEL_LEVEL_ACTION_INVERSE, PCNT_CHANNEL_LEVEL_ACTION_KEEP);
+
+  // the limits are watch points so that the driver accumulates the count
+  pcnt_unit_add_watch_point(unit, HW_LIMIT);
+  pcnt_unit_add_watch_point(unit, -HW_LIMIT);
+
+  // the driver sets the pins as inputs with no pullups
+  pinMode(_pinA, (ENABLE_PULLUPS ? INPUT_PULLUP : INPUT));
+  pinMode(_pinB, (ENABLE_PULLUPS ? INPUT_PULLUP : INPUT));
+
+  _hwOver = 0;
+  _hwTotal = _hwUsed = 0;
+#if ENABLE_POSITION
+  _hwPos = 0;
+#endif
+
+  pcnt_unit_enable(unit);
+  pcnt_unit_clear_count(unit);
+  pcnt_unit_start(unit);
+
+  hwHandle[_hwNext] = unit;
+  _hwUnit = _hwNext++;
+
+  return(true);
+}
+
+void MD_REncoder::hwLimit(void *arg)
+// Not used, the driver handles the limit events
+{
+  (void)arg;
+}
+
+int32_t MD_REncoder::hwCount(void)
+// The driver adds the limit events to the count
+{
+  int count;
+
+  if (pcnt_unit_get_count(hwHandle[_hwUnit], &count) != ESP_OK)
+    return(_hwTotal);
+
+  return(count);
+}
+
+#else
+#include "driver/pcnt.h"
+#include "soc/pcnt_struct.h"
+
+static MD_REncoder *hwObj[PCNT_UNIT_MAX]; // encoder for each unit used
+
+bool MD_REncoder::hwBegin(void)
+{
+  pcnt_config_t cfg;
+  pcnt_unit_t unit;
+
+  if (_hwNext >= PCNT_UNIT_MAX)
+    return(false);
+  unit = (pcnt_unit_t)_hwNext;
+
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.unit = unit;
+  cfg.counter_h_lim = HW_LIMIT;
+  cfg.counter_l_lim = -HW_LIMIT;
+
+  cfg.channel = PCNT_CHANNEL_0;
+  cfg.pulse_gpio_num = _pinA;
+  cfg.ctrl_gpio_num = _pinB;
+  cfg.pos_mode = PCNT_COUNT_INC;
+  cfg.neg_mode = PCNT_COUNT_DEC;
+  cfg.hctrl_mode = PCNT_MODE_KEEP;
+  cfg.lctrl_mode = PCNT_MODE_REVERSE;
+  if (pcnt_unit_config(&cfg) != ESP_OK)
+    return(false);
+
+  cfg.channel = PCNT_CHANNEL_1;
+  cfg.pulse_gpio_num = _pinB;
+  cfg.ctrl_gpio_num = _pinA;
+  cfg.hctrl_mode = PCNT_MODE_REVERSE;
+  cfg.lctrl_mode = PCNT_MODE_KEEP;
+  if (pcnt_unit_config(&cfg) != ESP_OK)
+    return(false);
+
+  // pcnt_unit_config() sets the pins as inputs with no pullups
+  pinMode(_pinA, (ENABLE_PULLUPS ? INPUT_PULLUP : INPUT));
+  pinMode(_pinB, (ENABLE_PULLUPS ? INPUT_PULLUP : INPUT));
+
+  // One interrupt handler for all the units, so that the limit event
+  // is added and cleared in one lock with respect to hwCount(). This
+  // takes the whole PCNT interrupt, so the pcnt ISR service cannot be
+  // used at the same time.
+  if (_hwNext == 0 && pcnt_isr_register(hwLimit, NULL, 0, NULL) != ESP_OK)
+    return(false);
+
+  _hwOver = 0;
+  _hwTotal = _hwUsed = 0;
+#if ENABLE_POSITION
+  _hwPos = 0;
+#endif
+  hwObj[unit] = this;
+
+  pcnt_set_filter_value(unit, HW_FILTER);
+  pcnt_filter_enable(unit);
+  pcnt_event_enable(unit, PCNT_EVT_H_LIM);
+  pcnt_event_enable(unit, PCNT_EVT_L_LIM);
+  pcnt_counter_pause(unit);
+  pcnt_counter_clear(unit);
+  pcnt_intr_enable(unit);
+  pcnt_counter_resume(unit);
+
+  _hwNext++;
+  _hwUnit = unit;
+
+  return(true);
+}
+
+void MD_REncoder::hwLimit(void *arg)
+// A counter has reached a limit and been reset to 0. Add the limit
+// to the extended count and clear the interrupt in one lock.
+{
+  uint32_t pending = PCNT.int_st.val;
+
+  (void)arg;
+  portENTER_CRITICAL_ISR(&hwMux);
+  for (uint8_t u = 0; u < PCNT_UNIT_MAX; u++)
+  {
+    if (pending & (1UL << u))
+    {
+      uint32_t status;
+
+      if (hwObj[u] != NULL && pcnt_get_event_status((pcnt_unit_t)u, &status) == ESP_OK)
+      {
+        if (status & PCNT_EVT_H_LIM) hwObj[u]->_hwOver += HW_LIMIT;
+        else if (status & PCNT_EVT_L_LIM) hwObj[u]->_hwOver -= HW_LIMIT;
+      }
+      PCNT.int_clr.val = (1UL << u);
+    }
+  }
+  portEXIT_CRITICAL_ISR(&hwMux);
+}
+
+int32_t MD_REncoder::hwCount(void)
+// Called with the lock held, so hwLimit() is either done or not
+// started. A limit reset that hwLimit() has not handled yet shows
+// as a pending interrupt, so the limit is added here. The counter
+// is read again if the reset came in during the read.
+{
+  uint32_t bit = (1UL << _hwUnit);
+  uint32_t pending, status;
+  int32_t over;
+  int16_t raw;
+
+  do
+  {
+    pending = PCNT.int_raw.val & bit;
+    if (pcnt_get_counter_value((pcnt_unit_t)_hwUnit, &raw) != ESP_OK)
+      return(_hwTotal);
+  } while (pending != (PCNT.int_raw.val & bit));
+
+  over = _hwOver;
+  if (pending && pcnt_get_event_status((pcnt_unit_t)_hwUnit, &status) == ESP_OK)
+  {
+    if (status & PCNT_EVT_H_LIM) over += HW_LIMIT;
+    else if (status & PCNT_EVT_L_LIM) over -= HW_LIMIT;
+  }
+
+  return(over + raw);
+}
+#endif
+#endif
+
+#endif
@@ -0,0 +1,112 @@
+/*
+MD_REncoder_Host - Desktop build support for the MD_REncoder library
+
+See MD_REncoder.h for comments and copyright notice.
+*/
+#ifndef _MD_RENCODER_HOST_H
+#define _MD_RENCODER_HOST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+/**
+ * \file
+ * \brief Host shim for the Arduino functions used by the MD_REncoder library
+ *
+ * This file is included instead of Arduino.h when ARDUINO is not defined, 
+ * so that the library can be compiled and run on a desktop computer. The pin 
+ * levels and the clock are simulated and are set using the MD_REncoderHost 
+ * class.
+ */
+
+#define LOW           0x0
+#define HIGH          0x1
+#define INPUT         0x0
+#define INPUT_PULLUP  0x2
+#define CHANGE        1
+#define NOT_AN_INTERRUPT  -1
+
+#define PROGMEM
+#define pgm_read_byte(p)  (*(const uint8_t *)(p))
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+/**
+ * Simulated pins and clock for a host build.
+ *
+ * All the methods are static as there is only one set of pins and one clock.
+ */
+class MD_REncoderHost
+{
+  public:
+  /**
+   * Set the level of a simulated pin.
+   *
+   * \param pin   the pin number, 0 to 63.
+   * \param level the pin level, 0 or 1.
+   */
+    static inline void setPin(uint8_t pin, uint8_t level) 
+    { 
+      if (level) pins() |= (1ULL << (pin & 63)); else pins() &= ~(1ULL << (pin & 63)); 
+    };
+
+  /**
+   * Get the level of a simulated pin.
+   *
+   * \param pin   the pin number, 0 to 63.
+   * \return The pin level, 0 or 1.
+   */
+    static inline uint8_t getPin(uint8_t pin) { return((pins() >> (pin & 63)) & 1); };
+
+  /**
+   * Set the simulated encoder output on pins A and B.
+   *
+   * \param pinA  the pin number for encoder output A.
+   * \param pinB  the pin number for encoder output B.
+   * \param code  the encoder output as (B<<1)|A, 0 to 3.
+   */
+    static inline void setCode(uint8_t pinA, uint8_t pinB, uint8_t code) 
+    { 
+      setPin(pinA, code & 1); 
+      setPin(pinB, (code >> 1) & 1); 
+    };
+
+  /**
+   * Set the simulated clock.
+   *
+   * \param t the time in microseconds.
+   */
+    static inline void setMicros(uint32_t t) { clock() = t; };
+
+  /**
+   * Move the simulated clock forward.
+   *
+   * \param dt the time in microseconds.
+   */
+    static inline void advance(uint32_t dt) { clock() += dt; };
+
+  /**
+   * Get the simulated clock.
+   *
+   * \return The time in microseconds.
+   */
+    static inline uint32_t getMicros(void) { return(clock()); };
+
+  private:
+    static inline uint64_t &pins(void) { static uint64_t p = ~0ULL; return(p); };
+    static inline uint32_t &clock(void) { static uint32_t t = 0; return(t); };
+};
+
+// Arduino functions used by the library
+inline void pinMode(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t pin) { return(MD_REncoderHost::getPin(pin)); }
+inline uint32_t micros(void) { return(MD_REncoderHost::getMicros()); }
+inline uint32_t millis(void) { return(MD_REncoderHost::getMicros() / 1000); }
+inline void noInterrupts(void) {}
+inline void interrupts(void) {}
+inline int digitalPinToInterrupt(uint8_t) { return(NOT_AN_INTERRUPT); }
+inline void attachInterrupt(uint8_t, void (*)(void), int) {}
+
+#endif
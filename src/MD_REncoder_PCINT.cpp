@@ -0,0 +1,152 @@
+/*
+MD_REncoder - Library for Rotary Encoders
+
+See header file for comments
+
+This version copyright (C) 2014 Marco Colli. All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+/**
+ * \file
+ * \brief Implements the pin change interrupt dispatcher
+ */
+#include <MD_REncoder.h>
+
+#if ENABLE_PCINT
+
+MD_REncoder *MD_REncoder::_pcObj[MAX_PCINT_ENCODERS] = { NULL };
+uint8_t MD_REncoder::_pcCount = 0;
+
+#if RE_PCINT_GROUPS && RE_FAST_IO
+volatile MD_REncoder::portReg_t *MD_REncoder::_pcPort[RE_PCINT_GROUPS] = { NULL };
+MD_REncoder::portReg_t MD_REncoder::_pcLast[RE_PCINT_GROUPS] = { 0 };
+MD_REncoder::portReg_t MD_REncoder::_pcMask[RE_PCINT_GROUPS] = { 0 };
+uint8_t MD_REncoder::_pcMap[RE_PCINT_GROUPS][8] = { { 0 } };
+
+// The built-in handlers, one per pin change interrupt group
+ISR(PCINT0_vect) { MD_REncoder::pcint(0); }
+#if RE_PCINT_GROUPS > 1
+ISR(PCINT1_vect) { MD_REncoder::pcint(1); }
+#endif
+#if RE_PCINT_GROUPS > 2
+ISR(PCINT2_vect) { MD_REncoder::pcint(2); }
+#endif
+#if RE_PCINT_GROUPS > 3
+ISR(PCINT3_vect) { MD_REncoder::pcint(3); }
+#endif
+
+bool MD_REncoder::attachPCINT(void)
+// Add both pins to the dispatcher map for their group and enable the 
+// pin change interrupts. The dispatcher reads the port register for the 
+// group, so each group must map to one port with the pin change bits 
+// in the same positions as the port bits. Return false if this cannot 
+// be done.
+{
+  const uint8_t pin[2] = { _pinA, _pinB };
+
+  if (regA() == NULL || _pcCount >= MAX_PCINT_ENCODERS)
+    return(false);
+
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    uint8_t g = digitalPinToPCICRbit(pin[i]);
+    volatile portReg_t *reg = (volatile portReg_t *)portInputRegister(digitalPinToPort(pin[i]));
+
+    if (digitalPinToPCICR(pin[i]) == NULL || g >= RE_PCINT_GROUPS ||
+        digitalPinToBitMask(pin[i]) != _BV(digitalPinToPCMSKbit(pin[i])) ||
+        (_pcPort[g] != NULL && _pcPort[g] != reg))
+      return(false);
+  }
+
+  _qHead = _qTail = 0;
+  _pcObj[_pcCount] = this;
+
+  noInterrupts();
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    uint8_t g = digitalPinToPCICRbit(pin[i]);
+    uint8_t bit = digitalPinToPCMSKbit(pin[i]);
+    portReg_t mask = _BV(bit);
+
+    _pcPort[g] = (volatile portReg_t *)portInputRegister(digitalPinToPort(pin[i]));
+    _pcMap[g][bit] = _pcCount + 1;
+    _pcMask[g] |= mask;
+    // only take the new pin into the last reading, so changes not yet 
+    // dispatched for the other encoders on this port are not lost
+    _pcLast[g] = (_pcLast[g] & ~mask) | (*_pcPort[g] & mask);
+    *digitalPinToPCMSK(pin[i]) |= mask;
+    *digitalPinToPCICR(pin[i]) |= _BV(g);
+  }
+  _pcCount++;
+  interrupts();
+
+  return(true);
+}
+
+void MD_REncoder::pcint(uint8_t group)
+// Read the port once and run the state table only for the encoders 
+// with pins that changed since the last reading.
+{
+  portReg_t v = *_pcPort[group];
+  portReg_t changed = (v ^ _pcLast[group]) & _pcMask[group];
+
+  _pcLast[group] = v;
+
+  for (uint8_t bit = 0; changed != 0; bit++)
+  {
+    portReg_t mask = _BV(bit);
+
+    if (changed & mask)
+    {
+      MD_REncoder *p = _pcObj[_pcMap[group][bit] - 1];
+      volatile portReg_t *ra = p->regA();
+      volatile portReg_t *rb = p->regB();
+      portReg_t a = (ra == _pcPort[group]) ? v : *ra;
+      portReg_t b = (rb == _pcPort[group]) ? v : *rb;
+
+#if ENABLE_INDEX
+      // the index is sampled with A and B, as by readPins()
+      if (p->_regZ != NULL)
+        p->_zRaw = ((((p->_regZ == _pcPort[group]) ? v : *p->_regZ) & p->_maskZ) ? 1 : 0);
+      else if (p->_pinZ != INDEX_NONE)
+        p->_zRaw = digitalRead(p->_pinZ);
+#endif
+
+      p->isrSample(((b & p->_maskB) ? 2 : 0) | ((a & p->_maskA) ? 1 : 0));
+
+      // both pins of the encoder are dealt with by one sample
+      if (ra == _pcPort[group]) changed &= ~p->_maskA;
+      if (rb == _pcPort[group]) changed &= ~p->_maskB;
+      changed &= ~mask;
+    }
+  }
+}
+#else
+bool MD_REncoder::attachPCINT(void)
+// No pin change interrupts that can be used
+{
+  return(false);
+}
+
+void MD_REncoder::pcint(uint8_t group)
+{
+  (void)group;
+}
+#endif
+
+#endif
@@ -0,0 +1,148 @@
+/*
+MD_REncoder - Library for Rotary Encoders
+
+See header file for comments
+
+This version copyright (C) 2014 Marco Colli. All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+/**
+ * \file
+ * \brief Implements the decode task and shared snapshot
+ */
+#include <MD_REncoder.h>
+
+#if ENABLE_TASK
+
+// Use a FreeRTOS task pinned to a core on ESP32
+#if defined(ESP32)
+#define RE_TASK_RTOS  1
+#define RE_TASK_STACK 2048  // task stack size in bytes
+#else
+#define RE_TASK_RTOS  0
+#endif
+
+// Keep the compiler and processor from moving memory accesses across 
+// the sequence number updates.
+#define RE_BARRIER()  __sync_synchronize()
+
+MD_REncoder *MD_REncoder::_taskObj[MAX_TASK_ENCODERS] = { NULL };
+volatile uint8_t MD_REncoder::_taskCount = 0;
+
+bool MD_REncoder::attachTask(void)
+// Add this encoder to the list read by service(). The list is only 
+// ever added to, so service() can run through it while this is done 
+// as long as the count is updated last.
+{
+  if (_taskCount >= MAX_TASK_ENCODERS)
+    return(false);
+
+  _taskObj[_taskCount] = this;
+  RE_BARRIER();
+  _taskCount++;
+
+  return(true);
+}
+
+void MD_REncoder::publish(void)
+// Read all the pending events and update the snapshot. This is the only 
+// writer, so the sequence number can be incremented without a lock.
+{
+  uint32_t count = _snap.count;
+  uint8_t dir = _snap.dir;
+  uint8_t e;
+
+  while ((e = read()) != DIR_NONE)
+  {
+    count++;
+    dir = e;
+  }
+
+  _seq++;
+  RE_BARRIER();
+  _snap.count = count;
+  _snap.dir = dir;
+#if ENABLE_POSITION
+  _snap.position = getPosition();
+#endif
+#if ENABLE_SPEED
+  _snap.speed = speed();
+#endif
+  RE_BARRIER();
+  _seq++;
+}
+
+void MD_REncoder::service(void)
+// Read each of the attached encoders
+{
+  uint8_t n = _taskCount;
+
+  for (uint8_t i = 0; i < n; i++)
+    _taskObj[i]->publish();
+}
+
+void MD_REncoder::getSnapshot(snapshot_t &s)
+// Copy the snapshot, and copy it again if service() was updating it 
+// before or during the copy.
+{
+  uint32_t seq;
+
+  do
+  {
+    seq = _seq;
+    RE_BARRIER();
+    memcpy(&s, (const void *)&_snap, sizeof(s));
+    RE_BARRIER();
+  } while ((seq & 1) != 0 || seq != _seq);
+}
+
+#if RE_TASK_RTOS
+static void taskLoop(void *arg)
+// Call service() at the period passed in arg (in ticks)
+{
+  TickType_t period = (TickType_t)(uintptr_t)arg;
+  TickType_t wake = xTaskGetTickCount();
+
+  for (;;)
+  {
+    MD_REncoder::service();
+    vTaskDelayUntil(&wake, period);
+  }
+}
+
+bool MD_REncoder::beginTask(uint16_t period, uint8_t core, uint8_t priority)
+{
+  TickType_t ticks = pdMS_TO_TICKS(period);
+
+  if (ticks == 0) ticks = 1;
+
+  return(xTaskCreatePinnedToCore(taskLoop, "MD_REncoder", RE_TASK_STACK, 
+    (void *)(uintptr_t)ticks, priority, NULL, core) == pdPASS);
+}
+#else
+bool MD_REncoder::beginTask(uint16_t period, uint8_t core, uint8_t priority)
+// No RTOS task support, service() is called by the application.
+{
+  (void)period;
+  (void)core;
+  (void)priority;
+  return(false);
+}
+#endif
+
+#endif
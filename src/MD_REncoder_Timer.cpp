@@ -0,0 +1,150 @@
+/*
+MD_REncoder - Library for Rotary Encoders
+
+See header file for comments
+
+This version copyright (C) 2014 Marco Colli. All rights reserved.
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 3 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+/**
+ * \file
+ * \brief Implements the timer tick sampler
+ */
+#include <MD_REncoder.h>
+
+#if ENABLE_TIMER
+
+// Use the built-in timer on AVR processors with Timer2
+#if defined(__AVR__) && defined(TIMER2_COMPA_vect)
+#define RE_TIMER_AVR  1
+#else
+#define RE_TIMER_AVR  0
+#endif
+
+MD_REncoder *MD_REncoder::_tickObj[MAX_TIMER_ENCODERS] = { NULL };
+volatile uint8_t MD_REncoder::_tickCount = 0;
+
+bool MD_REncoder::attachSampler(void)
+// Add this encoder to the list sampled by tick(). The list is only 
+// ever added to, so tick() can safely run through it while this is 
+// done as long as the count is updated last.
+{
+  if (_isr || _tickCount >= MAX_TIMER_ENCODERS)
+    return(false);
+
+  _qHead = _qTail = 0;
+  _isr = true;
+  _tickObj[_tickCount] = this;
+  noInterrupts();
+  _tickCount++;
+  interrupts();
+
+  return(true);
+}
+
+void MD_REncoder::tick(void)
+// Sample each of the attached encoders
+{
+  uint8_t n = _tickCount;
+
+  for (uint8_t i = 0; i < n; i++)
+    _tickObj[i]->isr();
+}
+
+#if ENABLE_ADAPTIVE
+uint16_t MD_REncoder::_adRate = 0;
+
+uint16_t MD_REncoder::adaptSampler(void)
+// Work out the rate for the shortest interval of the attached encoders 
+// and only set up the timer again if the rate has changed.
+{
+  uint8_t n = _tickCount;
+  uint32_t interval = 0;
+  uint32_t rate;
+
+  for (uint8_t i = 0; i < n; i++)
+  {
+    uint32_t t = _tickObj[i]->pollInterval();
+
+    if (i == 0 || t < interval) interval = t;
+  }
+
+  if (interval == 0)
+    return(_adRate);
+
+  rate = 1000000UL / interval;
+  if (rate > 0xffff) rate = 0xffff;
+  if (rate == 0) rate = 1;
+
+  if (rate != _adRate)
+  {
+    _adRate = rate;
+    beginSampler(_adRate);
+  }
+
+  return(_adRate);
+}
+#endif
+
+#if RE_TIMER_AVR
+ISR(TIMER2_COMPA_vect)
+{
+  MD_REncoder::tick();
+}
+
+bool MD_REncoder::beginSampler(uint16_t rate)
+// Set Timer2 to CTC mode using the smallest prescaler that gives a 
+// compare value that fits in 8 bits, for the best rate resolution.
+{
+  static const uint16_t prescale[] = { 1, 8, 32, 64, 128, 256, 1024 };
+
+  if (rate == 0)
+    return(false);
+
+  for (uint8_t i = 0; i < sizeof(prescale)/sizeof(prescale[0]); i++)
+  {
+    uint32_t top = F_CPU / ((uint32_t)prescale[i] * rate);
+
+    if (top >= 2 && top <= 256)
+    {
+      uint8_t sreg = SREG;
+
+      cli();
+      TCCR2A = _BV(WGM21);  // CTC mode, TOP = OCR2A
+      TCCR2B = i + 1;       // CS22:20 selects prescale[i]
+      TCNT2 = 0;
+      OCR2A = top - 1;
+      TIFR2 = _BV(OCF2A);   // clear any pending compare match
+      TIMSK2 |= _BV(OCIE2A);
+      SREG = sreg;
+      return(true);
+    }
+  }
+
+  return(false);
+}
+#else
+bool MD_REncoder::beginSampler(uint16_t rate)
+// No built-in timer, tick() is called by the application.
+{
+  (void)rate;
+  return(false);
+}
+#endif
+
+#endif